@@ -1,57 +1,73 @@
 #include "bitboard.h"
+#include "position.h"
 
-Bitboard PawnAttacks[SQ_NB];
+Bitboard PawnSteps[SQ_NB][16];
+Bitboard PawnJumps[SQ_NB][NO_DIRECTION + 1][16];
+uint8_t PawnAdjacency[SQ_NB][SQ_NB];
+
+#ifdef BITBOARD_SIMD
+std::array<Bitboard, SQ_NB> PawnAttacks;
 Bitboard ValidWalls;
 Bitboard ValidSquares;
-Bitboard GoalMask[COLOR_NB];
+std::array<Bitboard, COLOR_NB> GoalMask;
+Bitboard EdgePoints;
+std::array<Bitboard, FILE_NB> FileMask;
+std::array<Bitboard, RANK_NB> RankMask;
+#endif
 
 
 void init() {
-    for (Rank rank = RANK_1; rank <= RANK_9; ++rank) {
-        for (File file = FILE_A; file <= FILE_I; ++file) {
-            Square sq = make_square(rank, file);
-            Bitboard attacks = Bitboard{0ULL, 0ULL};
-            // i think we should just add the cardinal directions first 
-            // then if a cardinal direction is special, aka opponent pawn, then add the correct diagonals
-            if (rank < RANK_9)
-                attacks |= square_bb(sq + NORTH);
-            if (rank > RANK_1)
-                attacks |= square_bb(sq + SOUTH);
-            if (file < FILE_I)
-                attacks |= square_bb(sq + EAST);
-            if (file > FILE_A)
-                attacks |= square_bb(sq + WEST);
+#ifdef BITBOARD_SIMD
+    PawnAttacks = BoardMasks::pawn_attacks();
+    ValidWalls = BoardMasks::valid_walls();
+    ValidSquares = BoardMasks::valid_squares();
+    GoalMask = BoardMasks::goal_masks();
+    EdgePoints = BoardMasks::edge_points();
+    FileMask = BoardMasks::file_masks();
+    RankMask = BoardMasks::rank_masks();
+#endif
 
-            PawnAttacks[sq] = attacks;
+    // Pawn moves for every exit pattern, so generation is a couple of lookups.
+    // Steps go to every open neighbour; jumps are indexed by the square we jump
+    // over, the direction from us to it and its own exit pattern.
+    for (Square sq = SQ_A1; sq < SQ_NB; ++sq) {
+        for (int exits = 0; exits < 16; ++exits) {
+            PawnSteps[sq][exits] = Bitboard{};
+            for (int i = 0; i < 4; ++i) {
+                Square to = sq + Cardinals[i];
+                if ((exits >> i) & 1 && to >= SQ_A1 && to < SQ_NB && (PawnAttacks[sq] & to))
+                    PawnSteps[sq][exits] |= to;
+            }
         }
-    }
 
-    // Horizontal and Vertical walls can both be represented by the same mask
-    ValidWalls = Bitboard{0ULL, 0ULL};
-    for (Rank rank = RANK_2; rank <= RANK_9; ++rank) {
-        for (File file = FILE_A; file <= FILE_H; ++file) {
-            Square sq = make_square(rank, file);
-            ValidWalls |= sq;
+        for (int dir = 0; dir <= NO_DIRECTION; ++dir) {
+            for (int exits = 0; exits < 16; ++exits) {
+                Bitboard jumps = Bitboard{};
+                if (dir < NO_DIRECTION) {
+                    // straight jump if nothing is behind the opponent, otherwise the two diagonals
+                    int straight = 1 << dir;
+                    int sides = dir < 2 ? 0b1100 : 0b0011;
+                    jumps = PawnSteps[sq][exits & (exits & straight ? straight : sides)];
+                }
+                PawnJumps[sq][dir][exits] = jumps;
+            }
         }
-    }
 
-    ValidSquares = Bitboard{0ULL, 0ULL};
-    for (Square sq = SQ_A1; sq < SQ_NB; ++sq) {
-        ValidSquares |= sq;
+        for (Square other = SQ_A1; other < SQ_NB; ++other) {
+            PawnAdjacency[sq][other] = NO_DIRECTION;
+            for (int i = 0; i < 4; ++i)
+                if (other == sq + Cardinals[i] && (PawnAttacks[sq] & other))
+                    PawnAdjacency[sq][other] = i;
+        }
     }
 
-    GoalMask[WHITE] = Bitboard{0ULL, 0ULL};
-    GoalMask[BLACK] = Bitboard{0ULL, 0ULL};
-    for (File file = FILE_A; file <= FILE_I; ++file) {
-        GoalMask[WHITE] |= make_square(RANK_9, file);
-        GoalMask[BLACK] |= make_square(RANK_1, file);
-    }
+    Zobrist::init();
 }
 
 
 void print_bitboard(Bitboard b) {
-    for (Rank rank = RANK_9; rank >= RANK_1; --rank) {
-        for (File file = FILE_A; file <= FILE_I; ++file) {
+    for (Rank rank = RANK_LAST; rank >= RANK_1; --rank) {
+        for (File file = FILE_A; file <= FILE_LAST; ++file) {
             Square sq = make_square(rank, file);
             if (b & sq)
                 std::cout << "1";
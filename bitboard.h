@@ -1,13 +1,22 @@
 #pragma once
 
 #include "types.h"
+#include <array>
 #include <iostream>
 
 void init();
 
+#ifdef BITBOARD_SIMD
+#include "bitboard_simd.h"
+#elif BOARD_SIZE <= 7
+#include "bitboard64.h"
+#else
+
+#define BB_CONSTEXPR constexpr
+
 struct Bitboard {
     uint64_t lower; // squares 0–63
-    uint64_t upper; // squares 64–80
+    uint64_t upper; // squares 64 and up
 
     operator bool() const {
         return lower | upper;
@@ -75,8 +84,8 @@ constexpr inline Bitboard operator>>(const Bitboard &b, const uint32_t &shift) {
 
 template<Direction D>
 constexpr Bitboard shift(Bitboard b) {
-    return D == NORTH ? b << 9 :
-           D == SOUTH ? b >> 9 :
+    return D == NORTH ? b << NORTH :
+           D == SOUTH ? b >> NORTH :
            D == EAST  ? b << 1 :
            D == WEST  ? b >> 1 :
            Bitboard{0ULL, 0ULL};
@@ -91,17 +100,120 @@ constexpr Square bb_square(Bitboard bb) {
     return pop_lsb(bb);
 }
 
-constexpr Bitboard operator&(Bitboard b, Square s) { return b & square_bb(s); }
-constexpr Bitboard operator|(Bitboard b, Square s) { return b | square_bb(s); }
-constexpr Bitboard operator^(Bitboard b, Square s) { return b ^ square_bb(s); }
+// Value (0 or 1) of the bit for square s, without branching on the word
+constexpr int bit_at(const Bitboard& b, Square s) {
+    return int(((s < 64 ? b.lower : b.upper) >> (s & 63)) & 1);
+}
+
+#endif
+
+BB_CONSTEXPR Bitboard operator&(Bitboard b, Square s) { return b & square_bb(s); }
+BB_CONSTEXPR Bitboard operator|(Bitboard b, Square s) { return b | square_bb(s); }
+BB_CONSTEXPR Bitboard operator^(Bitboard b, Square s) { return b ^ square_bb(s); }
+
+BB_CONSTEXPR Bitboard& operator&=(Bitboard& b, Square s) { return b &= square_bb(s); }
+BB_CONSTEXPR Bitboard& operator|=(Bitboard& b, Square s) { return b |= square_bb(s); }
+BB_CONSTEXPR Bitboard& operator^=(Bitboard& b, Square s) { return b ^= square_bb(s); }
+
+// Cardinal directions in the bit order used by exit patterns:
+// bit i of a 4-bit pattern means a pawn can step towards Cardinals[i]
+constexpr Direction Cardinals[4] = {NORTH, SOUTH, EAST, WEST};
+constexpr int NO_DIRECTION = 4;
+
+extern Bitboard PawnSteps[SQ_NB][16];
+extern Bitboard PawnJumps[SQ_NB][NO_DIRECTION + 1][16];
+extern uint8_t PawnAdjacency[SQ_NB][SQ_NB];
+
+// Board masks, built from the board size alone
+namespace BoardMasks {
+
+BB_CONSTEXPR std::array<Bitboard, SQ_NB> pawn_attacks() {
+    std::array<Bitboard, SQ_NB> attacks{};
+    for (Square sq = SQ_A1; sq < SQ_NB; ++sq) {
+        // i think we should just add the cardinal directions first
+        // then if a cardinal direction is special, aka opponent pawn, then add the correct diagonals
+        if (rank_of(sq) < RANK_LAST)
+            attacks[sq] |= square_bb(sq + NORTH);
+        if (rank_of(sq) > RANK_1)
+            attacks[sq] |= square_bb(sq + SOUTH);
+        if (file_of(sq) < FILE_LAST)
+            attacks[sq] |= square_bb(sq + EAST);
+        if (file_of(sq) > FILE_A)
+            attacks[sq] |= square_bb(sq + WEST);
+    }
+    return attacks;
+}
+
+// Horizontal and Vertical walls can both be represented by the same mask
+BB_CONSTEXPR Bitboard valid_walls() {
+    Bitboard walls{};
+    for (Rank rank = RANK_2; rank <= RANK_LAST; ++rank)
+        for (File file = FILE_A; file < FILE_LAST; ++file)
+            walls |= make_square(rank, file);
+    return walls;
+}
+
+BB_CONSTEXPR Bitboard valid_squares() {
+    Bitboard squares{};
+    for (Square sq = SQ_A1; sq < SQ_NB; ++sq)
+        squares |= sq;
+    return squares;
+}
+
+BB_CONSTEXPR std::array<Bitboard, COLOR_NB> goal_masks() {
+    std::array<Bitboard, COLOR_NB> goals{};
+    for (File file = FILE_A; file <= FILE_LAST; ++file) {
+        goals[WHITE] |= make_square(RANK_LAST, file);
+        goals[BLACK] |= make_square(RANK_1, file);
+    }
+    return goals;
+}
+
+BB_CONSTEXPR std::array<Bitboard, FILE_NB> file_masks() {
+    std::array<Bitboard, FILE_NB> files{};
+    for (Square sq = SQ_A1; sq < SQ_NB; ++sq)
+        files[file_of(sq)] |= sq;
+    return files;
+}
+
+BB_CONSTEXPR std::array<Bitboard, RANK_NB> rank_masks() {
+    std::array<Bitboard, RANK_NB> ranks{};
+    for (Square sq = SQ_A1; sq < SQ_NB; ++sq)
+        ranks[rank_of(sq)] |= sq;
+    return ranks;
+}
 
-constexpr Bitboard& operator&=(Bitboard& b, Square s) { return b &= square_bb(s); }
-constexpr Bitboard& operator|=(Bitboard& b, Square s) { return b |= square_bb(s); }
-constexpr Bitboard& operator^=(Bitboard& b, Square s) { return b ^= square_bb(s); }
+// Wall corners share the wall index grid: the corner at sq is the middle of both
+// walls indexed sq. Corners on the board edge land on the last file, rank 1 or just
+// past the last square (the north ends of last-rank vertical walls). West of file A
+// they land on the last file one rank down, or on the sentinel column of a padded layout.
+BB_CONSTEXPR Bitboard edge_points() {
+    Bitboard points = valid_squares() & ~valid_walls();
+    for (File file = FILE_A; file < FILE_LAST; ++file)
+        points |= Square(SQ_NB + file);
+    return points | shift<WEST>(file_masks()[FILE_A]);
+}
+
+}
 
-extern Bitboard PawnAttacks[SQ_NB];
+// SSE vectors can't be built at compile time, so that backend's masks are
+// globals filled in by init(); the word backends have them as constants.
+#ifdef BITBOARD_SIMD
+extern std::array<Bitboard, SQ_NB> PawnAttacks;
 extern Bitboard ValidWalls;
 extern Bitboard ValidSquares;
-extern Bitboard GoalMask[COLOR_NB];
+extern std::array<Bitboard, COLOR_NB> GoalMask;
+extern Bitboard EdgePoints;
+extern std::array<Bitboard, FILE_NB> FileMask;
+extern std::array<Bitboard, RANK_NB> RankMask;
+#else
+inline constexpr std::array<Bitboard, SQ_NB> PawnAttacks = BoardMasks::pawn_attacks();
+inline constexpr Bitboard ValidWalls = BoardMasks::valid_walls();
+inline constexpr Bitboard ValidSquares = BoardMasks::valid_squares();
+inline constexpr std::array<Bitboard, COLOR_NB> GoalMask = BoardMasks::goal_masks();
+inline constexpr Bitboard EdgePoints = BoardMasks::edge_points();
+inline constexpr std::array<Bitboard, FILE_NB> FileMask = BoardMasks::file_masks();
+inline constexpr std::array<Bitboard, RANK_NB> RankMask = BoardMasks::rank_masks();
+#endif
 
 void print_bitboard(Bitboard b);
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+// Single-word Bitboard backend, picked by bitboard.h for boards of 7x7 and less,
+// where every square plus the row of wall corners past the last rank fits in one
+// uint64_t. Same layout as the two-word board: square s is bit s.
+
+#define BB_CONSTEXPR constexpr
+
+struct Bitboard {
+    uint64_t bits;
+
+    constexpr operator bool() const {
+        return bits;
+    }
+};
+
+// Counts total number of set bits in the board
+inline int popcount(const Bitboard& b) {
+    return __builtin_popcountll(b.bits);
+}
+
+// Finds and clears the least significant bit
+constexpr inline Square pop_lsb(Bitboard& b) {
+    const Square s = Square(__builtin_ctzll(b.bits));
+    b.bits &= b.bits - 1;
+    return s;
+}
+
+constexpr inline Bitboard operator|(const Bitboard& b1, const Bitboard& b2) { return Bitboard{b1.bits | b2.bits}; }
+constexpr inline Bitboard operator&(const Bitboard& b1, const Bitboard& b2) { return Bitboard{b1.bits & b2.bits}; }
+constexpr inline Bitboard operator^(const Bitboard& b1, const Bitboard& b2) { return Bitboard{b1.bits ^ b2.bits}; }
+constexpr inline Bitboard operator~(const Bitboard& b) { return Bitboard{~b.bits}; }
+constexpr inline bool operator!(const Bitboard &b) { return !b.bits; }
+
+constexpr inline Bitboard& operator|=(Bitboard& b1, const Bitboard& b2) { b1.bits |= b2.bits; return b1; }
+constexpr inline Bitboard& operator&=(Bitboard& b1, const Bitboard& b2) { b1.bits &= b2.bits; return b1; }
+constexpr inline Bitboard& operator^=(Bitboard& b1, const Bitboard& b2) { b1.bits ^= b2.bits; return b1; }
+
+constexpr inline Bitboard operator<<(const Bitboard &b, const uint32_t &shift) { return Bitboard{b.bits << shift}; }
+constexpr inline Bitboard operator>>(const Bitboard &b, const uint32_t &shift) { return Bitboard{b.bits >> shift}; }
+
+template<Direction D>
+constexpr Bitboard shift(Bitboard b) {
+    return D == NORTH ? b << NORTH :
+           D == SOUTH ? b >> NORTH :
+           D == EAST  ? b << 1 :
+           D == WEST  ? b >> 1 :
+           Bitboard{};
+}
+
+constexpr Bitboard square_bb(Square s) {
+    return Bitboard{1ULL << s};
+}
+
+constexpr Square bb_square(Bitboard bb) {
+    // making sure that there is only one bit set in the bb
+    return pop_lsb(bb);
+}
+
+// Value (0 or 1) of the bit for square s
+constexpr int bit_at(const Bitboard& b, Square s) {
+    return int((b.bits >> s) & 1);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+// SSE2 Bitboard backend, selected with -DBITBOARD_SIMD (make BITBOARD=simd).
+// Ranks are padded to 10 bits: square s lives at bit s + s / 9, and bit 9 of every
+// rank is a sentinel column that belongs to no square. A square shifted east off
+// file I or west off file A lands on a sentinel instead of the neighbouring rank,
+// so a shift never moves a square onto the wrong square. The sentinels double as
+// the west-edge wall corners (see EdgePoints). The whole board, plus the row of
+// corners past rank 9, fits in one __m128i.
+// Only shift<D> is provided, as raw << and >> mean something else in this layout.
+
+#include <immintrin.h>
+
+static_assert(BOARD_SIZE == 9, "the padded SSE layout is only laid out for the 9x9 board");
+
+#define BB_CONSTEXPR inline
+
+struct Bitboard {
+    __m128i v;
+
+    Bitboard() = default;
+    Bitboard(__m128i v) : v(v) {}
+    // raw words of the padded layout, only ever used for the empty board
+    Bitboard(uint64_t lo, uint64_t hi) : v(_mm_set_epi64x(int64_t(hi), int64_t(lo))) {}
+
+    uint64_t lo() const { return uint64_t(_mm_cvtsi128_si64(v)); }
+    uint64_t hi() const { return uint64_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(v, v))); }
+
+    operator bool() const {
+#ifdef __SSE4_1__
+        return !_mm_testz_si128(v, v);
+#else
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF;
+#endif
+    }
+};
+
+// square <-> bit index, squares up to the row of corners past rank 9
+constexpr int padded_bit(Square s) { return s + s / 9; }
+constexpr Square padded_square(int bit) { return Square(bit - bit / 10); }
+
+// Counts total number of set bits in the board
+inline int popcount(const Bitboard& b) {
+    return __builtin_popcountll(b.lo()) + __builtin_popcountll(b.hi());
+}
+
+// Finds and clears the least significant bit
+inline Square pop_lsb(Bitboard& b) {
+    const uint64_t lo = b.lo();
+    if (lo) {
+        b.v = _mm_xor_si128(b.v, _mm_cvtsi64_si128(int64_t(lo & -lo)));
+        return padded_square(__builtin_ctzll(lo));
+    }
+
+    const uint64_t hi = b.hi();
+    b.v = _mm_xor_si128(b.v, _mm_slli_si128(_mm_cvtsi64_si128(int64_t(hi & -hi)), 8));
+    return padded_square(__builtin_ctzll(hi) + 64);
+}
+
+inline Bitboard operator|(const Bitboard& b1, const Bitboard& b2) { return _mm_or_si128(b1.v, b2.v); }
+inline Bitboard operator&(const Bitboard& b1, const Bitboard& b2) { return _mm_and_si128(b1.v, b2.v); }
+inline Bitboard operator^(const Bitboard& b1, const Bitboard& b2) { return _mm_xor_si128(b1.v, b2.v); }
+inline Bitboard operator~(const Bitboard& b) { return _mm_xor_si128(b.v, _mm_set1_epi32(-1)); }
+inline bool operator!(const Bitboard &b) { return !bool(b); }
+
+inline Bitboard& operator|=(Bitboard& b1, const Bitboard& b2) { return b1 = b1 | b2; }
+inline Bitboard& operator&=(Bitboard& b1, const Bitboard& b2) { return b1 = b1 & b2; }
+inline Bitboard& operator^=(Bitboard& b1, const Bitboard& b2) { return b1 = b1 ^ b2; }
+
+// 128-bit shifts by N < 64 bits: shift both words, then carry across the middle
+template<int N>
+inline __m128i shl128(__m128i x) {
+    return _mm_or_si128(_mm_slli_epi64(x, N), _mm_srli_epi64(_mm_slli_si128(x, 8), 64 - N));
+}
+
+template<int N>
+inline __m128i shr128(__m128i x) {
+    return _mm_or_si128(_mm_srli_epi64(x, N), _mm_slli_epi64(_mm_srli_si128(x, 8), 64 - N));
+}
+
+template<Direction D>
+inline Bitboard shift(Bitboard b) {
+    return D == NORTH ? shl128<10>(b.v) :
+           D == SOUTH ? shr128<10>(b.v) :
+           D == EAST  ? shl128<1>(b.v) :
+           D == WEST  ? shr128<1>(b.v) :
+           _mm_setzero_si128();
+}
+
+inline Bitboard square_bb(Square s) {
+    const int bit = padded_bit(s);
+    const __m128i one = _mm_cvtsi64_si128(int64_t(1ULL << (bit & 63)));
+    return bit < 64 ? one : _mm_slli_si128(one, 8);
+}
+
+inline Square bb_square(Bitboard bb) {
+    // making sure that there is only one bit set in the bb
+    return pop_lsb(bb);
+}
+
+// Value (0 or 1) of the bit for square s
+inline int bit_at(const Bitboard& b, Square s) {
+    const int bit = padded_bit(s);
+    return int(((bit < 64 ? b.lo() : b.hi()) >> (bit & 63)) & 1);
+}
@@ -0,0 +1,123 @@
+#include "book.h"
+#include "search.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+OpeningBook Book;
+
+namespace {
+constexpr char BOOK_MAGIC[8] = {'Q', 'B', 'O', 'O', 'K', '1', 0, 0};
+}
+
+bool OpeningBook::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(BookHeader))
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    const BookHeader* header = static_cast<const BookHeader*>(map);
+    if (std::memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0
+        // divided, as a damaged count times the entry size can wrap past the file size
+        || header->count > (size_t(st.st_size) - sizeof(BookHeader)) / sizeof(BookEntry)) {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    mapping = map;
+    mapping_size = st.st_size;
+    entries = reinterpret_cast<const BookEntry*>(header + 1);
+    count = header->count;
+    return true;
+}
+
+void OpeningBook::close() {
+    if (mapping)
+        munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+const BookEntry* OpeningBook::probe(const Position& pos) const {
+    const BookEntry* end = entries + count;
+    const BookEntry* e = std::lower_bound(entries, end, pos.key,
+        [](const BookEntry& entry, uint64_t key) { return entry.key < key; });
+    if (e == end || e->key != pos.key || !MoveList(pos).contains(e->move()))
+        return nullptr;
+    return e;
+}
+
+size_t build_book(const std::string& path, int max_plies, int depth) {
+    std::unordered_map<uint64_t, BookEntry> book;
+
+    // depth-first over the book tree; transpositions are searched once
+    auto visit = [&](auto&& self, Position& pos, int ply) -> void {
+        if (ply >= max_plies || pos.is_terminal() || book.count(pos.key))
+            return;
+
+        Move best{};
+        new_game();
+        int score = iterative_deepening(pos, depth, 0, best);
+        book[pos.key] = BookEntry{pos.key, uint8_t(best.from), uint8_t(best.to), uint8_t(best.type),
+                                  uint8_t(last_search_stats().depth), int32_t(score)};
+
+        Move moves[256];
+        Move* last = generate_pawn_moves(pos, moves);
+        if (best.type != PAWN)
+            *last++ = best;
+        for (Move* m = moves; m != last; ++m) {
+            pos.do_move(*m);
+            self(self, pos, ply + 1);
+            pos.undo_move(*m);
+        }
+    };
+
+    // the search is chatty and must not answer from the book being replaced
+    SearchOptions saved = search_options;
+    search_options.book = false;
+    std::streambuf* out = std::cout.rdbuf(nullptr);
+    Position pos;
+    visit(visit, pos, 0);
+    std::cout.rdbuf(out);
+    std::cout.clear();
+    search_options = saved;
+
+    std::vector<BookEntry> entries;
+    entries.reserve(book.size());
+    for (const auto& kv : book)
+        entries.push_back(kv.second);
+    std::sort(entries.begin(), entries.end(),
+              [](const BookEntry& a, const BookEntry& b) { return a.key < b.key; });
+
+    BookHeader header{};
+    std::memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    header.count = entries.size();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BookEntry));
+    if (!file) {
+        std::cout << "Could not write book " << path << "\n";
+        return 0;
+    }
+    std::cout << "Book " << path << ": " << entries.size() << " positions, "
+              << max_plies << " plies, depth " << depth << "\n";
+    return entries.size();
+}
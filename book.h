@@ -0,0 +1,57 @@
+#pragma once
+
+#include "position.h"
+#include <cstddef>
+#include <string>
+
+// Opening book file: a header, then entries sorted by Zobrist key, in host byte
+// order. Keys depend on the fixed Zobrist seed, so a book stays valid as long as
+// Zobrist::init draws the same numbers.
+struct BookHeader {
+    char magic[8];      // "QBOOK1\0\0"
+    uint64_t count;
+};
+
+struct BookEntry {
+    uint64_t key;
+    uint8_t from;
+    uint8_t to;
+    uint8_t type;
+    uint8_t depth;      // of the search that chose the move
+    int32_t score;      // from the side to move
+
+    Move move() const { return Move{Square(from), Square(to), MoveType(type)}; }
+};
+
+static_assert(sizeof(BookEntry) == 16, "book entries are written as raw bytes");
+
+// Read-only view of a book file mapped into memory; probes binary search the
+// mapping in place
+class OpeningBook {
+public:
+    OpeningBook() = default;
+    ~OpeningBook() { close(); }
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    // false (and no book) if the file is missing or not a book
+    bool open(const std::string& path);
+    void close();
+    size_t size() const { return count; }
+
+    // the entry for pos, if its move is legal there
+    const BookEntry* probe(const Position& pos) const;
+
+private:
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    const BookEntry* entries = nullptr;
+    size_t count = 0;
+};
+
+extern OpeningBook Book;
+
+// Searches every position reached in the first max_plies plies of the game,
+// following the chosen move and every pawn move, each to the given depth, and
+// writes the chosen moves to path. Returns the number of positions stored.
+size_t build_book(const std::string& path, int max_plies, int depth);
@@ -0,0 +1,131 @@
+#include "capi.h"
+#include "position.h"
+#include "movegen.h"
+#include "search.h"
+#include <mutex>
+
+static_assert(sizeof(qd_move) == 3 && sizeof(qd_position) == 6 + 3 * QD_MAX_WALLS,
+              "qd_ structs are shared with other languages byte for byte");
+static_assert(QD_MAX_WALLS >= MAX_WALLS && QD_PAWN == PAWN && QD_H_WALL == H_WALL && QD_V_WALL == V_WALL,
+              "the C interface mirrors the engine's numbering");
+
+namespace {
+
+std::once_flag init_flag;
+
+void ensure_init() {
+    std::call_once(init_flag, [] {
+        init();
+        search_options.verbose = false;
+        search_options.book = false;
+    });
+}
+
+qd_move to_qd(Move m) {
+    return qd_move{uint8_t(m.from), uint8_t(m.to), uint8_t(m.type)};
+}
+
+// Replays the walls on an empty board, then puts the pawns and counts in place
+bool to_position(const qd_position& in, Position& pos) {
+    if (in.pawn[WHITE] >= SQ_NB || in.pawn[BLACK] >= SQ_NB || in.pawn[WHITE] == in.pawn[BLACK]
+        || in.walls_left[WHITE] > WALLS_PER_PLAYER || in.walls_left[BLACK] > WALLS_PER_PLAYER
+        || in.side_to_move > BLACK || in.num_walls > MAX_WALLS)
+        return false;
+
+    pos = Position();
+    for (int i = 0; i < in.num_walls; ++i) {
+        const qd_move& w = in.walls[i];
+        if ((w.type != H_WALL && w.type != V_WALL) || w.from >= SQ_NB)
+            return false;
+
+        Bitboard h_walls, v_walls;
+        pseudo_legal_walls(pos, h_walls, v_walls);
+        if (!bit_at(w.type == H_WALL ? h_walls : v_walls, Square(w.from)))
+            return false;
+        pos.do_move(Move{Square(w.from), SQ_NONE, MoveType(w.type)});
+    }
+
+    pos.pawn[WHITE] = Square(in.pawn[WHITE]);
+    pos.pawn[BLACK] = Square(in.pawn[BLACK]);
+    pos.num_walls[WHITE] = in.walls_left[WHITE];
+    pos.num_walls[BLACK] = in.walls_left[BLACK];
+    pos.side_to_move = Color(in.side_to_move);
+    pos.key = pos.compute_key();
+    return true;
+}
+
+}
+
+int qd_version(void) { return QD_VERSION; }
+
+int qd_board_size(void) { return BOARD_SIZE; }
+
+void qd_init(void) { ensure_init(); }
+
+void qd_set_threads(int threads) { set_search_threads(threads); }
+
+void qd_set_hash(int mb) {
+    ensure_init();
+    TT.resize(std::max(1, mb));
+}
+
+int qd_legal_moves(const qd_position* positions, int n, qd_move* moves, int* counts) {
+    ensure_init();
+    int invalid = 0;
+    Position pos;
+    for (int i = 0; i < n; ++i) {
+        if (!to_position(positions[i], pos)) {
+            counts[i] = -1;
+            ++invalid;
+            continue;
+        }
+        qd_move* out = moves + size_t(i) * QD_MAX_MOVES;
+        const MoveList list(pos);
+        for (Move m : list)
+            *out++ = to_qd(m);
+        counts[i] = int(list.size());
+    }
+    return invalid;
+}
+
+int qd_eval(const qd_position* positions, int n, int32_t* scores) {
+    ensure_init();
+    int invalid = 0;
+    Position pos;
+    for (int i = 0; i < n; ++i) {
+        if (!to_position(positions[i], pos)) {
+            scores[i] = QD_INVALID;
+            ++invalid;
+            continue;
+        }
+        scores[i] = eval(pos);
+    }
+    return invalid;
+}
+
+int qd_search(const qd_position* positions, int n, int depth, int time_ms,
+              int32_t* scores, qd_move* best) {
+    ensure_init();
+    int invalid = 0;
+    Position pos;
+    for (int i = 0; i < n; ++i) {
+        best[i] = to_qd(MOVE_NONE);
+        if (!to_position(positions[i], pos)) {
+            scores[i] = QD_INVALID;
+            ++invalid;
+            continue;
+        }
+        // the side to move has just lost
+        if (pos.is_terminal()) {
+            scores[i] = LOSS_SCORE;
+            continue;
+        }
+
+        Move m = MOVE_NONE;
+        new_game();
+        scores[i] = iterative_deepening(pos, depth > 0 ? std::min(depth, MAX_DEPTH - 1) : MAX_DEPTH - 1,
+                                        std::max(0, time_ms), m);
+        best[i] = to_qd(m);
+    }
+    return invalid;
+}
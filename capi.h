@@ -0,0 +1,74 @@
+#pragma once
+
+// C interface of libquoridor.so (make lib), for calling the engine from other
+// languages; python/quoridor.py loads it with ctypes. Everything works on arrays
+// of positions so one call can cover a whole batch. The structs are plain bytes
+// and only ever grow at the end; qd_version() changes whenever they do.
+//
+// On an n x n board (n = qd_board_size(), 9 unless built with another
+// BOARD_SIZE) squares are 0..n*n-1, a1 = 0, rank-major, with white starting in
+// the middle of rank 1 (e1, 4, on 9x9) and heading for rank n. A wall is named
+// by its square as in the engine: a horizontal wall on s closes s and s + 1 off
+// from the squares below them, a vertical wall on s closes s and s - n off from
+// the squares east of them.
+// Not thread-safe: searches share the engine's tables.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QD_API __attribute__((visibility("default")))
+
+#define QD_VERSION 2
+// room for the moves of any position; callers pass QD_MAX_MOVES slots per position
+#define QD_MAX_MOVES 256
+#define QD_MAX_WALLS 64
+#define QD_NONE 255
+// score of a position that failed validation
+#define QD_INVALID INT32_MIN
+
+#define QD_PAWN 0
+#define QD_H_WALL 1
+#define QD_V_WALL 2
+
+typedef struct {
+    uint8_t from;
+    uint8_t to;       // QD_NONE for walls
+    uint8_t type;
+} qd_move;
+
+typedef struct {
+    uint8_t pawn[2];          // white, black
+    uint8_t walls_left[2];
+    uint8_t side_to_move;     // 0 white, 1 black
+    uint8_t num_walls;        // walls on the board, in walls[0..num_walls)
+    qd_move walls[QD_MAX_WALLS];
+} qd_position;
+
+QD_API int qd_version(void);
+// Squares per side; callers built for another board must not use the library
+QD_API int qd_board_size(void);
+// Builds the engine's tables; the other calls do it on first use
+QD_API void qd_init(void);
+QD_API void qd_set_threads(int threads);
+QD_API void qd_set_hash(int mb);
+
+// Each returns how many positions failed validation (off-board or shared pawn
+// squares, more walls in hand than a player starts with (10 on 9x9), more on the
+// board than both together, walls off the grid, overlapping or crossing). Those get a count of -1, a score of QD_INVALID and no best move.
+// Walls may cut a pawn off, as positions are taken as given.
+
+// Legal moves of position i go to moves[i * QD_MAX_MOVES ...], counts[i] of them
+QD_API int qd_legal_moves(const qd_position* positions, int n, qd_move* moves, int* counts);
+// Static evaluation, from the side to move
+QD_API int qd_eval(const qd_position* positions, int n, int32_t* scores);
+// Searches each position from a fresh table to depth (0 for no limit) or for
+// time_ms (0 for no limit); scores from the side to move
+QD_API int qd_search(const qd_position* positions, int n, int depth, int time_ms,
+                     int32_t* scores, qd_move* best);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,183 @@
+#include "distcache.h"
+#include "movegen.h"
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+DistanceCache DistCache;
+
+namespace {
+
+constexpr int NUM_WORDS = (SQ_NB + 7) / 8;
+
+// keeps the two colors apart, and the empty board's key away from 0, which marks a free slot
+constexpr uint64_t ColorSalt[COLOR_NB] = {0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL};
+
+uint64_t entry_key(uint64_t wall_key, Color c) {
+    return wall_key ^ ColorSalt[c];
+}
+
+std::mutex stats_mutex;
+DistCacheStats ended_threads;
+
+void add(DistCacheStats& to, const DistCacheStats& from) {
+    to.probes += from.probes;
+    to.hits += from.hits;
+    to.stores += from.stores;
+    to.evictions += from.evictions;
+}
+
+struct ThreadCounts {
+    DistCacheStats stats;
+    ~ThreadCounts() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        add(ended_threads, stats);
+    }
+};
+
+thread_local ThreadCounts thread_counts;
+
+} // namespace
+
+DistanceCache::DistanceCache(size_t size_mb) {
+    resize(size_mb);
+}
+
+void DistanceCache::resize(size_t size_mb) {
+    num_buckets = size_mb * 1024 * 1024 / sizeof(DistBucket);
+    buckets.reset(num_buckets ? new DistBucket[num_buckets] : nullptr);
+    recent.reset(num_buckets ? new std::atomic<uint8_t>[num_buckets] : nullptr);
+    clear();
+}
+
+void DistanceCache::clear() {
+    for (size_t i = 0; i < num_buckets; ++i) {
+        for (DistEntry& e : buckets[i].entries) {
+            e.key.store(0, std::memory_order_relaxed);
+            for (auto& w : e.words)
+                w.store(0, std::memory_order_relaxed);
+        }
+        recent[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+const DistEntry* DistanceCache::find(uint64_t key) const {
+    for (const DistEntry& e : buckets[index(key)].entries)
+        if (e.key.load(std::memory_order_acquire) == key)
+            return &e;
+    return nullptr;
+}
+
+bool DistanceCache::probe(uint64_t wall_key, Color c, uint8_t dist[SQ_NB]) {
+    if (!enabled())
+        return false;
+    thread_counts.stats.probes++;
+
+    const uint64_t key = entry_key(wall_key, c);
+    const DistEntry* e = find(key);
+    if (!e)
+        return false;
+
+    uint64_t words[NUM_WORDS];
+    for (int w = 0; w < NUM_WORDS; ++w)
+        words[w] = e->words[w].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (e->key.load(std::memory_order_relaxed) != key)
+        return false;
+
+    std::memcpy(dist, words, SQ_NB);
+    thread_counts.stats.hits++;
+    return true;
+}
+
+bool DistanceCache::probe(uint64_t wall_key, Color c, Square s, int& d) {
+    if (!enabled())
+        return false;
+    thread_counts.stats.probes++;
+
+    const uint64_t key = entry_key(wall_key, c);
+    const DistEntry* e = find(key);
+    if (!e)
+        return false;
+
+    const uint64_t word = e->words[s / 8].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (e->key.load(std::memory_order_relaxed) != key)
+        return false;
+
+    d = int(uint8_t(word >> (8 * (s % 8))));
+    thread_counts.stats.hits++;
+    return true;
+}
+
+// An empty slot if there is one, otherwise the one not stored last. A slot another
+// thread is writing, or one that changes under us, is left to that thread.
+void DistanceCache::store(uint64_t wall_key, Color c, const uint8_t dist[SQ_NB]) {
+    if (!enabled())
+        return;
+
+    const uint64_t key = entry_key(wall_key, c);
+    const size_t i = index(key);
+    // read once: another store may move it mid-loop, which would leave no slot to take
+    const int last = recent[i].load(std::memory_order_relaxed);
+    DistEntry* replace = nullptr;
+    uint64_t old_key = 0;
+    for (int slot = 0; slot < DIST_BUCKET_SIZE; ++slot) {
+        DistEntry& e = buckets[i].entries[slot];
+        const uint64_t k = e.key.load(std::memory_order_relaxed);
+        if (k == key || k == DIST_BUSY)
+            return;
+        if (!replace && (k == 0 || slot != last)) {
+            replace = &e;
+            old_key = k;
+        }
+    }
+    if (!replace->key.compare_exchange_strong(old_key, DIST_BUSY, std::memory_order_relaxed))
+        return;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (old_key != 0)
+        thread_counts.stats.evictions++;
+    thread_counts.stats.stores++;
+    recent[i].store(uint8_t(replace - buckets[i].entries), std::memory_order_relaxed);
+
+    uint64_t words[NUM_WORDS] = {};
+    std::memcpy(words, dist, SQ_NB);
+    for (int w = 0; w < NUM_WORDS; ++w)
+        replace->words[w].store(words[w], std::memory_order_relaxed);
+    replace->key.store(key, std::memory_order_release);
+}
+
+int DistanceCache::distance(const Position& pos, Color c) {
+    if (!enabled())
+        return distance_to_goal(pos, c);
+
+    int d;
+    if (probe(pos.wall_key, c, pos.pawn[c], d))
+        return d;
+
+    uint8_t dist[SQ_NB];
+    distance_field(pos, c, dist);
+    store(pos.wall_key, c, dist);
+    return dist[pos.pawn[c]];
+}
+
+DistCacheStats DistanceCache::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    DistCacheStats s = ended_threads;
+    add(s, thread_counts.stats);
+    return s;
+}
+
+void DistanceCache::reset_stats() {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    ended_threads = DistCacheStats{};
+    thread_counts.stats = DistCacheStats{};
+}
+
+void DistanceCache::print_stats() const {
+    const DistCacheStats s = stats();
+    const uint64_t p = s.probes, h = s.hits;
+    std::cout << "Distance cache probes: " << p << ", hits: " << h << " (" << (p ? 100.0 * h / p : 0.0) << "%)"
+              << ", stores: " << s.stores << ", evictions: " << s.evictions << "\n";
+}
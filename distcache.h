@@ -0,0 +1,71 @@
+#pragma once
+
+#include "position.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Distance-to-goal field of one color under one wall configuration, 8 squares a word.
+// A writer claims the slot by swapping its key for DIST_BUSY, writes the words and
+// sets the new key after, so a reader that sees the same key before and after its
+// copy got a whole field, and two writers never fill the same slot at once.
+struct DistEntry {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> words[(SQ_NB + 7) / 8];
+};
+
+constexpr int DIST_BUCKET_SIZE = 2;
+// key of a slot being written; 0 is a free one
+constexpr uint64_t DIST_BUSY = ~0ULL;
+
+struct DistCacheStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t stores = 0;
+    uint64_t evictions = 0;
+};
+
+struct alignas(64) DistBucket {
+    DistEntry entries[DIST_BUCKET_SIZE];
+};
+
+// Fields keyed on Position::wall_key and shared by all search threads, since the
+// same walls come back under many pawn placements. A full bucket evicts the entry
+// that was stored longer ago.
+class DistanceCache {
+public:
+    explicit DistanceCache(size_t size_mb = 16);
+
+    // 0 turns the cache off
+    void resize(size_t size_mb);
+    void clear();
+    bool enabled() const { return num_buckets != 0; }
+
+    bool probe(uint64_t wall_key, Color c, uint8_t dist[SQ_NB]);
+    // just the distance of s
+    bool probe(uint64_t wall_key, Color c, Square s, int& d);
+    void store(uint64_t wall_key, Color c, const uint8_t dist[SQ_NB]);
+
+    // distance_to_goal, filling the cache with the whole field on a miss
+    int distance(const Position& pos, Color c);
+
+    // counted per thread like the transposition table's (tt.h)
+    DistCacheStats stats() const;
+    void reset_stats();
+    void print_stats() const;
+
+private:
+    size_t index(uint64_t key) const {
+        return (unsigned __int128)key * num_buckets >> 64;
+    }
+    // the entry holding key, if any
+    const DistEntry* find(uint64_t key) const;
+
+    std::unique_ptr<DistBucket[]> buckets;
+    // per bucket, the slot stored last; only stores write it, so probes keep
+    // the shared lines read-only
+    std::unique_ptr<std::atomic<uint8_t>[]> recent;
+    size_t num_buckets = 0;
+};
+
+extern DistanceCache DistCache;
@@ -0,0 +1,209 @@
+#include "distfield.h"
+
+void DistanceFields::init(const Position& pos) {
+    for (Color c : {WHITE, BLACK}) {
+        if (!DistCache.probe(pos.wall_key, c, dist[c])) {
+            distance_field(pos, c, dist[c]);
+            DistCache.store(pos.wall_key, c, dist[c]);
+        }
+        std::fill(std::begin(layers[c]), std::end(layers[c]), Bitboard{});
+        num_layers[c] = 0;
+        for (Square s = SQ_A1; s < SQ_NB; ++s) {
+            if (dist[c][s] == NO_PATH)
+                continue;
+            layers[c][dist[c][s]] |= s;
+            num_layers[c] = std::max(num_layers[c], dist[c][s] + 1);
+        }
+        applied[c] = 0;
+    }
+    h_walls_full = pos.h_walls_full;
+    v_walls_full = pos.v_walls_full;
+    wall_keys[0] = pos.wall_key;
+    num_walls = 0;
+    num_changes = 0;
+}
+
+void DistanceFields::do_move(const Position& pos, Move m) {
+    if (m.type == PAWN)
+        return;
+
+    wall_marks[num_walls] = num_changes;
+    walls[num_walls++] = m;
+    wall_keys[num_walls] = pos.wall_key;
+    h_walls_full = pos.h_walls_full;
+    v_walls_full = pos.v_walls_full;
+}
+
+void DistanceFields::undo_move(Move m) {
+    if (m.type == PAWN)
+        return;
+
+    --num_walls;
+    if (m.type == H_WALL)
+        h_walls_full ^= square_bb(m.from) | (m.from + EAST);
+    else
+        v_walls_full ^= square_bb(m.from) | (m.from + SOUTH);
+
+    // an update made at this level covered this wall and maybe some before it
+    for (Color c : {WHITE, BLACK})
+        if (applied[c] > num_walls)
+            applied[c] = applied_before[c][num_walls];
+
+    while (num_changes > wall_marks[num_walls]) {
+        const Change& change = changes[--num_changes];
+        const Color c = Color(change.sq >= SQ_NB);
+        const Square s = Square(change.sq - c * SQ_NB);
+        uint8_t& d = dist[c][s];
+        if (d != NO_PATH)
+            layers[c][d] ^= s;
+        d = change.old;
+        layers[c][d] ^= s;
+    }
+}
+
+template<typename F>
+void DistanceFields::for_each_cut_end(Color c, F&& f) const {
+    const uint8_t* d = dist[c];
+    for (int i = applied[c]; i < num_walls; ++i) {
+        const Square s = walls[i].from;
+        const Square other = walls[i].type == H_WALL ? s + EAST : s + SOUTH;
+        const Direction across = walls[i].type == H_WALL ? SOUTH : EAST;
+        const Square edges[2][2] = {{s, s + across}, {other, other + across}};
+
+        for (const auto& edge : edges)
+            if (d[edge[0]] != d[edge[1]])
+                f(d[edge[0]] > d[edge[1]] ? edge[0] : edge[1]);
+    }
+}
+
+int DistanceFields::distance(Color c, Square s) const {
+    if (!lengthened(c, s))
+        return dist[c][s];
+
+    // the field is out of date here; a flood fill from s is cheaper than updating it
+    const Passable passable(h_walls_full, v_walls_full);
+    Bitboard visited = square_bb(s);
+    Bitboard frontier = visited;
+    for (int d = 0; frontier; ++d) {
+        if (frontier & GoalMask[c])
+            return d;
+        frontier = passable.expand(frontier) & ~visited;
+        visited |= frontier;
+    }
+    return NO_PATH;
+}
+
+bool DistanceFields::lengthened(Color c, Square s) const {
+    const int from = dist[c][s];
+    if (applied[c] == num_walls || from == NO_PATH)
+        return false;
+
+    // A downhill path through a cut end is at least as long as the walk there.
+    // Layers below the lowest cut end are untouched.
+    int lo = NO_PATH;
+    bool near = false;
+    for_each_cut_end(c, [&](Square f) {
+        lo = std::min(lo, int(dist[c][f]));
+        near |= std::abs(file_of(s) - file_of(f)) + std::abs(rank_of(s) - rank_of(f))
+             <= from - dist[c][f];
+    });
+    if (!near)
+        return false;
+
+    // Follow the old shortest paths of s downhill over the edges still open;
+    // reaching the layer under the cut means the distance still holds
+    const Passable passable(h_walls_full, v_walls_full);
+    Bitboard frontier = square_bb(s);
+    for (int k = from; k >= lo; --k) {
+        frontier = passable.expand(frontier) & layers[c][k - 1];
+        if (!frontier)
+            return true;
+    }
+    return false;
+}
+
+void DistanceFields::update(Color c) {
+    if (applied[c] == num_walls)
+        return;
+
+    Bitboard ends = Bitboard{};
+    int lo = NO_PATH, hi = 0;
+    for_each_cut_end(c, [&](Square f) {
+        ends |= f;
+        lo = std::min(lo, int(dist[c][f]));
+        hi = std::max(hi, int(dist[c][f]));
+    });
+    applied_before[c][num_walls - 1] = applied[c];
+    applied[c] = num_walls;
+    if (lo == NO_PATH)
+        return;
+
+    uint8_t cached[SQ_NB];
+    if (DistCache.probe(wall_keys[num_walls], c, cached)) {
+        load(c, cached);
+        return;
+    }
+
+    uint8_t* d = dist[c];
+    Bitboard* layer = layers[c];
+    const Passable passable(h_walls_full, v_walls_full);
+
+    // Affected squares lost every neighbour one layer closer. A layer only depends
+    // on the one before, and only cut ends and children of affected squares qualify.
+    Bitboard cut = Bitboard{};
+    Bitboard prev = Bitboard{};
+    for (int k = lo; k < num_layers[c] && (k <= hi || prev); ++k) {
+        const Bitboard candidates = (ends | passable.expand(prev)) & layer[k];
+        prev = candidates & ~passable.expand(layer[k - 1] & ~cut);
+        cut |= prev;
+    }
+    if (!cut) {
+        DistCache.store(wall_keys[num_walls], c, d);
+        return;
+    }
+
+    for (Bitboard b = cut; b; ) {
+        const Square x = pop_lsb(b);
+        changes[num_changes++] = Change{uint8_t(c * SQ_NB + x), d[x]};
+        d[x] = NO_PATH;
+    }
+
+    // Distances only grow, so re-layer the affected squares outwards from layer lo - 1,
+    // which is intact. Whatever is never reached stays at NO_PATH.
+    Bitboard todo = cut;
+    Bitboard frontier = layer[lo - 1];
+    for (int k = lo; todo && frontier; ++k) {
+        const Bitboard reached = passable.expand(frontier) & todo;
+        todo &= ~reached;
+        for (Bitboard b = reached; b; )
+            d[pop_lsb(b)] = uint8_t(k);
+
+        if (k < num_layers[c])
+            layer[k] &= ~cut;
+        else
+            num_layers[c] = k + 1;
+        layer[k] |= reached;
+        frontier = layer[k];
+    }
+    for (int k = 0; k < num_layers[c]; ++k)
+        layer[k] &= ~todo;
+
+    DistCache.store(wall_keys[num_walls], c, d);
+}
+
+void DistanceFields::load(Color c, const uint8_t cached[SQ_NB]) {
+    uint8_t* d = dist[c];
+    Bitboard* layer = layers[c];
+    for (Square s = SQ_A1; s < SQ_NB; ++s) {
+        if (d[s] == cached[s])
+            continue;
+
+        changes[num_changes++] = Change{uint8_t(c * SQ_NB + s), d[s]};
+        layer[d[s]] ^= s;
+        d[s] = cached[s];
+        if (d[s] == NO_PATH)
+            continue;
+        layer[d[s]] |= s;
+        num_layers[c] = std::max(num_layers[c], d[s] + 1);
+    }
+}
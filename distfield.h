@@ -0,0 +1,62 @@
+#pragma once
+
+#include "movegen.h"
+#include "distcache.h"
+
+// Distance-to-goal of every square for both colors, kept in step with a search.
+// Pawn moves leave the fields alone. A wall only lengthens paths, and only for
+// squares whose every shortest path crossed it: those are found layer by layer
+// from the closed edges outwards and re-layered from their unaffected
+// neighbours, with the old values logged so undo_move can put them back.
+// Walls are only applied to a field when the whole field is read, several at a
+// time if need be. Reading one square just checks that it still has a downhill
+// path through the old layers, so most leaves never update anything.
+// Fields brought up to date go into DistCache, and updates try it first. Leaves
+// don't: their wall sets are mostly new, and the flood fill beats a cache miss.
+class DistanceFields {
+public:
+    // From scratch, also forgets the undo log
+    void init(const Position& pos);
+    // pos is the position after m
+    void do_move(const Position& pos, Move m);
+    // m must be the last move passed to do_move
+    void undo_move(Move m);
+
+    int distance(Color c, Square s) const;
+    const uint8_t* field(Color c) { update(c); return dist[c]; }
+
+private:
+    struct Change {
+        uint8_t sq;   // c * SQ_NB + square
+        uint8_t old;
+    };
+
+    // Calls f(far) for the far end of every tree edge of c's field that a pending
+    // wall closes; only those squares can lose their way to the goal directly
+    template<typename F>
+    void for_each_cut_end(Color c, F&& f) const;
+    // did the pending walls lengthen the distance of s?
+    bool lengthened(Color c, Square s) const;
+    void update(Color c);
+    // moves field c onto a cached one, logging the squares that differ
+    void load(Color c, const uint8_t cached[SQ_NB]);
+
+    uint8_t dist[COLOR_NB][SQ_NB];
+    // the same maps as one bitboard per distance; squares at NO_PATH are in none
+    Bitboard layers[COLOR_NB][SQ_NB];
+    int num_layers[COLOR_NB];
+
+    // walls placed since init; the first applied[c] of them are in c's field
+    Move walls[MAX_WALLS];
+    int num_walls;
+    int applied[COLOR_NB];
+    int applied_before[COLOR_NB][MAX_WALLS];
+    Bitboard h_walls_full, v_walls_full;
+    // Position::wall_key at init and after each wall
+    uint64_t wall_keys[MAX_WALLS + 1];
+
+    // each wall level updates a field at most once
+    Change changes[MAX_WALLS * COLOR_NB * SQ_NB];
+    int num_changes;
+    int wall_marks[MAX_WALLS];
+};
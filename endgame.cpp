@@ -0,0 +1,145 @@
+#include "endgame.h"
+#include <iostream>
+
+RaceTable RaceTB;
+
+int race_separated(const Position& pos, int us_dist, int them_dist) {
+    const Color us = pos.side_to_move;
+    const int plies = us_dist <= them_dist ? 2 * us_dist - 1 : 2 * them_dist;
+
+    // Every move closes the gap by at most one step, so pawns more than plies
+    // steps apart are never next to each other before the last move
+    const Square a = pos.pawn[us], b = pos.pawn[~us];
+    if (std::abs(file_of(a) - file_of(b)) + std::abs(rank_of(a) - rank_of(b)) > plies)
+        return plies < RACE_OPEN ? plies : RACE_OPEN;
+
+    const Passable passable(pos);
+    const Bitboard target = square_bb(pos.pawn[~us]);
+    Bitboard visited = square_bb(pos.pawn[us]);
+    Bitboard frontier = visited;
+    for (int d = 0; d <= plies && frontier; ++d) {
+        if (frontier & target)
+            return RACE_OPEN;
+        frontier = passable.expand(frontier) & ~visited;
+        visited |= frontier;
+    }
+    return plies < RACE_OPEN ? plies : RACE_OPEN;
+}
+
+namespace {
+
+constexpr int NUM_STATES = COLOR_NB * SQ_NB * SQ_NB;
+
+int state_index(Color stm, Square w, Square b) {
+    return (stm * SQ_NB + w) * SQ_NB + b;
+}
+
+} // namespace
+
+// Retrograde analysis: finished games are losses in 0 for the side to move, a
+// position is won once any move reaches a lost one and lost once all its moves
+// reach won ones. Going through the positions in order of plies gives the fastest
+// win and the slowest loss.
+RaceSolution::RaceSolution(const Position& pos) : wall_key(pos.wall_key) {
+    const Passable passable(pos);
+    uint8_t* result = &plies[0][0][0];
+    std::fill(result, result + NUM_STATES, uint8_t(RACE_OPEN));
+
+    std::vector<uint8_t> open_moves(NUM_STATES, 0);
+    std::vector<uint16_t> children(NUM_STATES * 8);
+    std::vector<int> num_children(NUM_STATES, 0);
+    std::vector<int> pred_start(NUM_STATES + 1, 0);
+    std::vector<uint16_t> queue;
+    queue.reserve(NUM_STATES);
+
+    for (Color stm : {WHITE, BLACK}) {
+        for (Square w = SQ_A1; w < SQ_NB; ++w) {
+            for (Square b = SQ_A1; b < SQ_NB; ++b) {
+                if (w == b)
+                    continue;
+                const int i = state_index(stm, w, b);
+                const Square pawn[COLOR_NB] = {w, b};
+
+                // the side that just moved reached its goal; the other way round never comes up
+                if (GoalMask[~stm] & pawn[~stm]) {
+                    if (!(GoalMask[stm] & pawn[stm])) {
+                        result[i] = 0;
+                        queue.push_back(uint16_t(i));
+                    }
+                    continue;
+                }
+                if (GoalMask[stm] & pawn[stm])
+                    continue;
+
+                Bitboard targets = pawn_targets(passable, pawn[stm], pawn[~stm]);
+                while (targets) {
+                    const Square to = pop_lsb(targets);
+                    const int child = stm == WHITE ? state_index(BLACK, to, b) : state_index(WHITE, w, to);
+                    children[i * 8 + num_children[i]++] = uint16_t(child);
+                    ++pred_start[child + 1];
+                }
+                open_moves[i] = uint8_t(num_children[i]);
+            }
+        }
+    }
+
+    // predecessors of each position, grouped by counting sort
+    for (int i = 0; i < NUM_STATES; ++i)
+        pred_start[i + 1] += pred_start[i];
+    std::vector<uint16_t> preds(pred_start[NUM_STATES]);
+    std::vector<int> fill(pred_start.begin(), pred_start.end() - 1);
+    for (int i = 0; i < NUM_STATES; ++i)
+        for (int k = 0; k < num_children[i]; ++k)
+            preds[fill[children[i * 8 + k]]++] = uint16_t(i);
+
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const int s = queue[head];
+        const int next = result[s] + 1;
+        if (next >= RACE_OPEN)
+            break;
+
+        for (int k = pred_start[s]; k < pred_start[s + 1]; ++k) {
+            const int p = preds[k];
+            if (result[p] != RACE_OPEN)
+                continue;
+            if (!race_won(result[s]) || --open_moves[p] == 0) {
+                result[p] = uint8_t(next);
+                queue.push_back(uint16_t(p));
+            }
+        }
+    }
+}
+
+void RaceTable::resize(size_t max_solutions) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = max_solutions;
+    if (solutions.size() > capacity)
+        solutions.erase(solutions.begin(), solutions.end() - capacity);
+}
+
+void RaceTable::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    solutions.clear();
+}
+
+std::shared_ptr<const RaceSolution> RaceTable::get(const Position& pos) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++lookups;
+
+    for (auto it = solutions.begin(); it != solutions.end(); ++it) {
+        if ((*it)->wall_key == pos.wall_key) {
+            std::rotate(it, it + 1, solutions.end());
+            return solutions.back();
+        }
+    }
+
+    if (solutions.size() >= capacity)
+        solutions.erase(solutions.begin());
+    ++solved;
+    solutions.push_back(std::make_shared<const RaceSolution>(pos));
+    return solutions.back();
+}
+
+void RaceTable::print_stats() const {
+    std::cout << "Race table lookups: " << lookups << ", wall configurations solved: " << solved << "\n";
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "movegen.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Pawn races: once neither side has walls left, the walls on the board are final
+// and the game only depends on the two pawns and the side to move. Results are
+// plies to the end of the game with best play, counted from the side to move:
+// odd is a win (it makes the last move), even a loss. Positions where neither
+// side can force the end, with the pawns blocking each other forever, stay open.
+constexpr int RACE_OPEN = 255;
+
+inline bool race_won(int plies) { return plies & 1; }
+
+// Exact without any search when the pawns are too far apart to ever meet before
+// the race is over, so neither can block or jump the other; RACE_OPEN otherwise.
+// us_dist and them_dist are the distances to goal of the side to move and the other.
+int race_separated(const Position& pos, int us_dist, int them_dist);
+
+// Every race under one wall configuration, solved backwards from the finished games
+struct RaceSolution {
+    uint64_t wall_key;
+    uint8_t plies[COLOR_NB][SQ_NB][SQ_NB];   // [side to move][white pawn][black pawn]
+
+    explicit RaceSolution(const Position& pos);
+    int probe(const Position& pos) const {
+        return plies[pos.side_to_move][pos.pawn[WHITE]][pos.pawn[BLACK]];
+    }
+};
+
+// Solutions for the last few wall configurations, shared by all search threads.
+// Below a position without walls left the walls never change again, so a search
+// thread fetches the solution once and keeps probing its own copy of the pointer.
+class RaceTable {
+public:
+    explicit RaceTable(size_t max_solutions = 16) : capacity(max_solutions) {}
+
+    // 0 turns the table off
+    void resize(size_t max_solutions);
+    void clear();
+    bool enabled() const { return capacity != 0; }
+
+    // solves pos's walls if they are not stored, evicting the least recently used
+    std::shared_ptr<const RaceSolution> get(const Position& pos);
+
+    uint64_t lookups = 0;
+    uint64_t solved = 0;
+    void print_stats() const;
+
+private:
+    std::mutex mutex;
+    // most recently used last
+    std::vector<std::shared_ptr<const RaceSolution>> solutions;
+    size_t capacity;
+};
+
+extern RaceTable RaceTB;
@@ -0,0 +1,212 @@
+#include "engine.h"
+#include "movegen.h"
+#include "search.h"
+#include "book.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+// replies come from both the reader and the search thread
+std::mutex out_mutex;
+
+void reply(const std::string& line) {
+    std::lock_guard<std::mutex> lock(out_mutex);
+    std::cout << line << std::endl;
+}
+
+Square parse_square(const std::string& s, size_t i) {
+    if (i + 1 >= s.size() || s[i] < 'a' || s[i] >= 'a' + FILE_NB || s[i + 1] < '1' || s[i + 1] >= '1' + RANK_NB)
+        return SQ_NONE;
+    return make_square(Rank(s[i + 1] - '1'), File(s[i] - 'a'));
+}
+
+std::string square_name(Square s) {
+    return {char('a' + file_of(s)), char('1' + rank_of(s))};
+}
+
+struct Engine {
+    Position pos;
+    std::thread worker;
+    std::atomic<bool> abort{false};
+    // the running search was started with go infinite and only ends on stop
+    bool infinite = false;
+
+    // lets a running search finish, or ends it first
+    void wait(bool stop) {
+        if (!worker.joinable())
+            return;
+        if (stop)
+            abort = true;
+        worker.join();
+    }
+    // before a command that needs the search out of the way: waiting on an
+    // infinite search would stop reading commands, including the stop that ends it
+    void settle() { wait(infinite); }
+
+    void position(std::istringstream& is);
+    void go(std::istringstream& is);
+    void setoption(std::istringstream& is);
+};
+
+void Engine::position(std::istringstream& is) {
+    std::string token;
+    is >> token;
+    if (token != "startpos") {
+        reply("info string expected startpos");
+        return;
+    }
+    pos = Position();
+    if (!(is >> token) || token != "moves")
+        return;
+    while (is >> token) {
+        const Move m = parse_move(pos, token);
+        if (m.is_none()) {
+            reply("info string illegal move " + token);
+            return;
+        }
+        pos.do_move(m);
+    }
+}
+
+void Engine::go(std::istringstream& is) {
+    SearchLimits limits;
+    int time[COLOR_NB] = {0, 0}, inc[COLOR_NB] = {0, 0};
+    std::string token;
+    infinite = false;
+    while (is >> token) {
+        if (token == "depth")          is >> limits.depth;
+        else if (token == "movetime")  is >> limits.move_time;
+        else if (token == "wtime")     is >> time[WHITE];
+        else if (token == "btime")     is >> time[BLACK];
+        else if (token == "winc")      is >> inc[WHITE];
+        else if (token == "binc")      is >> inc[BLACK];
+        else if (token == "movestogo") is >> limits.moves_to_go;
+        else if (token == "nodes")     is >> limits.nodes;
+        else if (token == "infinite")  infinite = true;
+    }
+    limits.depth = std::max(1, std::min(limits.depth, MAX_DEPTH - 1));
+    // infinite lifts the time and node limits, wherever it comes in the command
+    if (infinite) {
+        limits.move_time = 0;
+        limits.nodes = 0;
+    }
+    else {
+        limits.time_left = time[pos.side_to_move];
+        limits.increment = inc[pos.side_to_move];
+    }
+
+    if (pos.is_terminal()) {
+        reply("bestmove none");
+        return;
+    }
+
+    abort = false;
+    limits.abort = &abort;
+    const auto start = std::chrono::steady_clock::now();
+    limits.on_iteration = [start](int depth, int score, long long nodes, Move best) {
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        std::ostringstream os;
+        os << "info depth " << depth << " score " << score << " nodes " << nodes
+           << " time " << ms << " pv " << move_to_string(best);
+        reply(os.str());
+    };
+
+    worker = std::thread([root = pos, limits]() mutable {
+        Move best = MOVE_NONE;
+        iterative_deepening(root, limits, best);
+        reply("bestmove " + (best.is_none() ? std::string("none") : move_to_string(best)));
+    });
+}
+
+void Engine::setoption(std::istringstream& is) {
+    std::string token, name, value;
+    is >> token >> name >> token >> value;
+    if (name == "Hash")
+        TT.resize(std::max(1, std::atoi(value.c_str())));
+    else if (name == "Threads")
+        set_search_threads(std::atoi(value.c_str()));
+    else if (name == "Engine")
+        search_options.mcts = value == "mcts";
+    else if (name == "EvalFile") {
+        search_options.nnue = value != "none";
+        if (search_options.nnue && !Nnue.load(value))
+            reply("info string cannot load network " + value);
+    }
+    else if (name == "Book") {
+        search_options.book = value != "none";
+        if (search_options.book && !Book.open(value))
+            reply("info string cannot open book " + value);
+    }
+    else
+        reply("info string unknown option " + name);
+}
+
+}
+
+std::string move_to_string(Move m) {
+    if (m.type == PAWN)
+        return square_name(m.from) + square_name(m.to);
+    return square_name(m.from) + (m.type == H_WALL ? "h" : "v");
+}
+
+Move parse_move(const Position& pos, const std::string& s) {
+    Move m = MOVE_NONE;
+    if (s.size() == 3 && (s[2] == 'h' || s[2] == 'v'))
+        m = Move{parse_square(s, 0), SQ_NONE, s[2] == 'h' ? H_WALL : V_WALL};
+    else if (s.size() == 4)
+        m = Move{parse_square(s, 0), parse_square(s, 2), PAWN};
+
+    if (m.from == SQ_NONE || !MoveList(pos).contains(m))
+        return MOVE_NONE;
+    return m;
+}
+
+void engine_loop() {
+    Engine engine;
+    search_options.verbose = false;
+
+    std::string line, cmd;
+    while (std::getline(std::cin, line)) {
+        std::istringstream is(line);
+        if (!(is >> cmd))
+            continue;
+
+        if (cmd == "quit")
+            break;
+        else if (cmd == "stop")
+            engine.wait(true);
+        else if (cmd == "isready")
+            reply("readyok");
+        else if (cmd == "go") {
+            engine.settle();
+            engine.go(is);
+        }
+        else if (cmd == "position") {
+            engine.settle();
+            engine.position(is);
+        }
+        else if (cmd == "setoption") {
+            engine.settle();
+            engine.setoption(is);
+        }
+        else if (cmd == "newgame") {
+            engine.settle();
+            new_game();
+        }
+        else if (cmd == "d") {
+            engine.settle();
+            std::lock_guard<std::mutex> lock(out_mutex);
+            engine.pos.print_board();
+        }
+        else
+            reply("info string unknown command " + cmd);
+    }
+    engine.wait(true);
+}
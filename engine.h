@@ -0,0 +1,34 @@
+#pragma once
+
+#include "position.h"
+#include <string>
+
+// Text protocol for driving the engine from another process, one command per line
+// on stdin and one reply per line on stdout:
+//
+//   position startpos [moves m1 m2 ...]
+//   go [depth N] [movetime MS] [wtime MS] [btime MS] [winc MS] [binc MS]
+//      [movestogo N] [nodes N] [infinite]
+//                        -> info depth D score S nodes N time MS pv M  (per iteration; main thread nodes)
+//                        -> bestmove M
+//   stop                 ends the search, which then answers bestmove
+//   setoption name Hash|Threads|Book|Engine|EvalFile value V
+//                        (Engine: alphabeta or mcts; EvalFile: network weights or none;
+//                        mcts ignores depth and counts playouts as nodes)
+//   newgame              forgets the transposition table and history
+//   isready              -> readyok
+//   d                    prints the board
+//   quit
+//
+// Squares are a1..i9 with white starting on e1. Pawn moves are the two squares
+// ("e1e2"), walls the wall's square and h or v ("e3h"). The search runs on its own
+// thread, so stop and isready are answered while it thinks; other commands wait
+// for it to finish, or stop it first if it was started with infinite. Tables and
+// history carry over between the moves of a game until newgame.
+
+std::string move_to_string(Move m);
+// MOVE_NONE unless s is a legal move in pos
+Move parse_move(const Position& pos, const std::string& s);
+
+// Reads commands until quit or end of input
+void engine_loop();
@@ -0,0 +1,325 @@
+// Self-play match between two engine configurations, spread over worker processes.
+// Every search global (TT, options, weights, caches) is per process, so each worker
+// just switches configurations before every move. Openings are random plies played
+// twice with colors swapped; results stream back through a pipe to the parent,
+// which reports Elo and stops as soon as the SPRT decides.
+//
+//   ./match --games 2000 --workers 8 --a depth=5 --b depth=5,wall=14 --elo0 0 --elo1 10
+//   ./match --a depth=64,tc=10000,inc=100 --b depth=64,tc=10000,inc=100,lmr=0
+//   ./match --a time=200 --b time=200,mcts=1
+//   ./match --nnue quoridor.nnue --a depth=5 --b depth=5,nnue=1
+
+#include "position.h"
+#include "movegen.h"
+#include "search.h"
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct EngineConfig {
+    int depth = 5;
+    int time_ms = 0;
+    // game clock: base time and increment in ms, moves per control (0 for all)
+    int clock_ms = 0;
+    int increment_ms = 0;
+    int moves_to_go = 0;
+    long long nodes = 0;
+    EvalWeights weights;
+    SearchOptions options;
+};
+
+struct MatchConfig {
+    EngineConfig engines[2];
+    int games = 1000;
+    int workers = std::max(1u, std::thread::hardware_concurrency());
+    int opening_plies = 6;
+    int max_plies = 300;
+    size_t hash_mb = 4;
+    uint32_t seed = 1;
+    double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+    std::string network;    // weights file for engines with nnue=1
+};
+
+// "key=value,key=value"; false on an unknown key
+bool parse_engine(const std::string& spec, EngineConfig& e) {
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos)
+            return false;
+        const std::string key = item.substr(0, eq);
+        const int value = std::stoi(item.substr(eq + 1));
+
+        if (key == "depth") e.depth = value;
+        else if (key == "time") e.time_ms = value;
+        else if (key == "tc") e.clock_ms = value;
+        else if (key == "inc") e.increment_ms = value;
+        else if (key == "mtg") e.moves_to_go = value;
+        else if (key == "nodes") e.nodes = value;
+        else if (key == "distance") e.weights.distance = value;
+        else if (key == "tempo") e.weights.tempo = value;
+        else if (key == "wall") e.weights.wall = value;
+        else if (key == "wall_late") e.weights.wall_late = value;
+        else if (key == "centrality") e.weights.centrality = value;
+        else if (key == "pvs") e.options.pvs = value;
+        else if (key == "aspiration") e.options.aspiration = value;
+        else if (key == "lmr") e.options.lmr = value;
+        else if (key == "races") e.options.races = value;
+        else if (key == "mcts") e.options.mcts = value;
+        else if (key == "nnue") e.options.nnue = value;
+        else return false;
+    }
+    return true;
+}
+
+// Random pawn moves with the odd wall, the same for both games of a pair
+Position random_opening(int pair, const MatchConfig& config) {
+    std::mt19937 rng(config.seed * 1000003u + pair);
+    Position pos;
+    for (int ply = 0; ply < config.opening_plies; ++ply) {
+        MoveList moves(pos);
+        std::vector<Move> pawn_moves;
+        for (Move m : moves)
+            if (m.type == PAWN)
+                pawn_moves.push_back(m);
+        const bool wall = rng() % 4 == 0 && moves.size() > pawn_moves.size();
+        Move m = wall ? moves.moves[pawn_moves.size() + rng() % (moves.size() - pawn_moves.size())]
+                      : pawn_moves[rng() % pawn_moves.size()];
+        pos.do_move(m);
+        if (pos.is_terminal())
+            break;
+    }
+    return pos;
+}
+
+enum GameResult : int8_t { A_LOSES = 0, DRAW = 1, A_WINS = 2 };
+
+struct ResultRecord {
+    int32_t game;
+    int8_t result;
+};
+
+// Even games give engine A white, odd games black. Running out of clock loses.
+GameResult play_game(int game, const MatchConfig& config) {
+    Position pos = random_opening(game / 2, config);
+    const Color a_color = game % 2 == 0 ? WHITE : BLACK;
+    int clock_left[COLOR_NB], moves_made[COLOR_NB] = {};
+    for (Color c : {WHITE, BLACK})
+        clock_left[c] = config.engines[c == a_color ? 0 : 1].clock_ms;
+
+    for (int ply = 0; ply < config.max_plies; ++ply) {
+        const Color us = pos.side_to_move;
+        if (pos.is_terminal()) {
+            // the side to move has just lost
+            return us == a_color ? A_LOSES : A_WINS;
+        }
+        const EngineConfig& e = config.engines[us == a_color ? 0 : 1];
+        search_options = e.options;
+        eval_weights = e.weights;
+        new_game();
+
+        SearchLimits limits;
+        limits.depth = e.depth;
+        limits.move_time = e.time_ms;
+        limits.nodes = e.nodes;
+        if (e.clock_ms) {
+            limits.time_left = clock_left[us];
+            limits.increment = e.increment_ms;
+            limits.moves_to_go = e.moves_to_go ? e.moves_to_go - moves_made[us] % e.moves_to_go : 0;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        Move best = MOVE_NONE;
+        iterative_deepening(pos, limits, best);
+        pos.do_move(best);
+
+        if (e.clock_ms) {
+            clock_left[us] -= int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            if (clock_left[us] < 0)
+                return us == a_color ? A_LOSES : A_WINS;
+            clock_left[us] += e.increment_ms;
+            if (e.moves_to_go && ++moves_made[us] % e.moves_to_go == 0)
+                clock_left[us] += e.clock_ms;
+        }
+    }
+    return DRAW;
+}
+
+void run_worker(int worker, const MatchConfig& config, int out_fd) {
+    // the engine reports every search; nothing of it is wanted here
+    std::cout.rdbuf(nullptr);
+    TT.resize(config.hash_mb);
+    set_search_threads(1);
+
+    for (int game = worker; game < config.games; game += config.workers) {
+        ResultRecord record{game, play_game(game, config)};
+        if (write(out_fd, &record, sizeof(record)) != sizeof(record))
+            break;
+    }
+}
+
+struct Stats {
+    int wins = 0, draws = 0, losses = 0;
+
+    int games() const { return wins + draws + losses; }
+    double score() const { return (wins + 0.5 * draws) / games(); }
+    // variance of one game's score
+    double variance() const {
+        const double s = score();
+        return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+    }
+};
+
+double elo_to_score(double elo) { return 1 / (1 + std::pow(10.0, -elo / 400)); }
+
+double score_to_elo(double s) {
+    s = std::min(std::max(s, 1e-6), 1 - 1e-6);
+    return -400 * std::log10(1 / s - 1);
+}
+
+// Log-likelihood ratio of elo1 against elo0, normal approximation of the trinomial
+double sprt_llr(const Stats& st, double elo0, double elo1) {
+    const double var = st.variance();
+    if (st.games() == 0 || var == 0)
+        return 0;
+    const double s0 = elo_to_score(elo0), s1 = elo_to_score(elo1);
+    return st.games() * (s1 - s0) * (2 * st.score() - s0 - s1) / (2 * var);
+}
+
+void report(const Stats& st, const MatchConfig& config, double lower, double upper) {
+    const double margin = 1.96 * std::sqrt(st.variance() / st.games());
+    const double elo = score_to_elo(st.score());
+    const double elo_lo = score_to_elo(st.score() - margin), elo_hi = score_to_elo(st.score() + margin);
+    std::cout << std::fixed << std::setprecision(1)
+              << "games " << st.games() << "  +" << st.wins << " =" << st.draws << " -" << st.losses
+              << "  elo " << elo << " [" << elo_lo << ", " << elo_hi << "]"
+              << std::setprecision(2) << "  llr " << sprt_llr(st, config.elo0, config.elo1)
+              << " (" << lower << ", " << upper << ")\n";
+}
+
+void usage() {
+    std::cout << "usage: match [--games N] [--workers N] [--a SPEC] [--b SPEC] [--openings PLIES]\n"
+                 "             [--max-plies N] [--hash MB] [--seed N] [--elo0 E] [--elo1 E]\n"
+                 "             [--alpha A] [--beta B] [--nnue FILE]\n"
+                 "SPEC: comma separated key=value with keys depth, time (ms per move),\n"
+                 "      tc, inc (game clock and increment in ms), mtg (moves per control), nodes,\n"
+                 "      distance, tempo, wall, wall_late, centrality, pvs, aspiration, lmr, races,\n"
+                 "      mcts (1 for Monte Carlo tree search; nodes then counts playouts),\n"
+                 "      nnue (1 to evaluate with the network from --nnue)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    MatchConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (!ok) {}
+        else if (arg == "--games") config.games = std::stoi(value);
+        else if (arg == "--workers") config.workers = std::max(1, std::stoi(value));
+        else if (arg == "--a") ok = parse_engine(value, config.engines[0]);
+        else if (arg == "--b") ok = parse_engine(value, config.engines[1]);
+        else if (arg == "--openings") config.opening_plies = std::stoi(value);
+        else if (arg == "--max-plies") config.max_plies = std::stoi(value);
+        else if (arg == "--hash") config.hash_mb = std::stoul(value);
+        else if (arg == "--seed") config.seed = std::stoul(value);
+        else if (arg == "--elo0") config.elo0 = std::stod(value);
+        else if (arg == "--elo1") config.elo1 = std::stod(value);
+        else if (arg == "--alpha") config.alpha = std::stod(value);
+        else if (arg == "--beta") config.beta = std::stod(value);
+        else if (arg == "--nnue") config.network = value;
+        else ok = false;
+        if (!ok) {
+            usage();
+            return 1;
+        }
+        ++i;
+    }
+    config.workers = std::min(config.workers, std::max(1, config.games));
+
+    init();
+    if (!config.network.empty() && !Nnue.load(config.network)) {
+        std::cerr << "cannot load network " << config.network << "\n";
+        return 1;
+    }
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::perror("pipe");
+        return 1;
+    }
+
+    std::vector<pid_t> workers;
+    for (int w = 0; w < config.workers; ++w) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            run_worker(w, config, fds[1]);
+            close(fds[1]);
+            _exit(0);
+        }
+        if (pid < 0) {
+            std::perror("fork");
+            break;
+        }
+        workers.push_back(pid);
+    }
+    close(fds[1]);
+
+    const double lower = std::log(config.beta / (1 - config.alpha));
+    const double upper = std::log((1 - config.beta) / config.alpha);
+    std::cout << "match: " << config.games << " games, " << workers.size() << " workers, SPRT elo0 "
+              << config.elo0 << " elo1 " << config.elo1 << "\n";
+
+    Stats st;
+    const int report_every = std::max(1, std::min(100, config.games / 20));
+    int reported = 0;
+    ResultRecord record;
+    const char* verdict = "inconclusive";
+    while (read(fds[0], &record, sizeof(record)) == sizeof(record)) {
+        if (record.result == A_WINS) ++st.wins;
+        else if (record.result == A_LOSES) ++st.losses;
+        else ++st.draws;
+
+        const double llr = sprt_llr(st, config.elo0, config.elo1);
+        if (llr >= upper || llr <= lower) {
+            verdict = llr >= upper ? "H1 accepted (A is stronger by elo1)" : "H0 accepted (A is not stronger by elo1)";
+            break;
+        }
+        if (st.games() % report_every == 0) {
+            report(st, config, lower, upper);
+            reported = st.games();
+        }
+    }
+    close(fds[0]);
+
+    for (pid_t pid : workers)
+        kill(pid, SIGTERM);
+    for (pid_t pid : workers)
+        waitpid(pid, nullptr, 0);
+
+    if (st.games() == 0) {
+        std::cout << "no games finished\n";
+        return 1;
+    }
+    if (reported != st.games())
+        report(st, config, lower, upper);
+    std::cout << "SPRT: " << verdict << "\n";
+    return 0;
+}
@@ -0,0 +1,395 @@
+#include "mcts.h"
+#include "movegen.h"
+#include "search.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+MctsTree Mcts;
+
+namespace {
+
+enum : uint8_t { UNEXPANDED, EXPANDING, EXPANDED };
+
+constexpr uint32_t NO_NODE = UINT32_MAX;
+constexpr float C_PUCT = 1.5f;
+// unvisited children are valued a little below their parent
+constexpr float FPU_REDUCTION = 0.2f;
+// playouts per search when neither time nor nodes are limited
+constexpr long long DEFAULT_PLAYOUTS = 50000;
+constexpr int MAX_PATH = 256;
+// a leaf is expanded once it has this many visits; most children are never
+// visited, so expanding sooner mostly fills the arena
+constexpr int EXPAND_VISITS = 8;
+// playouts stop here and are scored by eval()
+constexpr int PLAYOUT_PLIES = 8;
+constexpr int RESULT_SCALE = 256;
+// eval() units per step of the logistic that turns it into a win rate
+constexpr double EVAL_SCALE = 150;
+
+// xorshift64*, one per thread
+struct Rng {
+    uint64_t s;
+    explicit Rng(uint64_t seed) : s(seed * 0x9E3779B97F4A7C15ULL | 1) {}
+    uint64_t next() {
+        s ^= s >> 12; s ^= s << 25; s ^= s >> 27;
+        return s * 0x2545F4914F6CDD1DULL;
+    }
+    int below(int n) { return int((next() >> 32) * uint64_t(n) >> 32); }
+};
+
+// Tree edges of a distance field that a wall closes (0, 1 or 2); only those can
+// make the field's paths longer
+int cuts(const uint8_t field[SQ_NB], Move wall) {
+    const Square s = wall.from;
+    const Square other = wall.type == H_WALL ? s + EAST : s + SOUTH;
+    const Direction across = wall.type == H_WALL ? SOUTH : EAST;
+    return (field[s] != field[s + across]) + (field[other] != field[other + across]);
+}
+
+int manhattan(Square a, Square b) {
+    return std::abs(file_of(a) - file_of(b)) + std::abs(rank_of(a) - rank_of(b));
+}
+
+// A step down our shortest path, now and then any step
+Move playout_pawn_move(const Position& pos, const uint8_t field[SQ_NB], Rng& rng) {
+    const Color us = pos.side_to_move;
+    Bitboard targets = pawn_targets(Passable(pos), pos.pawn[us], pos.pawn[~us]);
+    const bool any = rng.below(10) == 0;
+    Square best = SQ_NONE;
+    int best_dist = NO_PATH + 1, ties = 0;
+    while (targets) {
+        const Square s = pop_lsb(targets);
+        const int d = any ? 0 : field[s];
+        if (d < best_dist) {
+            best = s;
+            best_dist = d;
+            ties = 1;
+        }
+        else if (d == best_dist && rng.below(++ties) == 0)
+            best = s;
+    }
+    return Move{pos.pawn[us], best, PAWN};
+}
+
+// A random legal wall across the opponent's shortest path near their pawn
+Move playout_wall(const Position& pos, const uint8_t their_field[SQ_NB], Rng& rng) {
+    const Square them = pos.pawn[~pos.side_to_move];
+    Move pick = MOVE_NONE;
+    int seen = 0;
+    for (Move m : MoveList(pos))
+        if (m.type != PAWN && manhattan(m.from, them) <= 3 && cuts(their_field, m)
+            && rng.below(++seen) == 0)
+            pick = m;
+    return pick;
+}
+
+// Result for the side to move, 0 (loss) to RESULT_SCALE (win)
+int playout(Position& pos, Rng& rng) {
+    const Color start = pos.side_to_move;
+    Move played[PLAYOUT_PLIES];
+    uint8_t field[COLOR_NB][SQ_NB];
+    distance_field(pos, WHITE, field[WHITE]);
+    distance_field(pos, BLACK, field[BLACK]);
+
+    int plies = 0;
+    int result;
+    while (true) {
+        const Color us = pos.side_to_move;
+        if (pos.is_terminal()) {
+            result = us == start ? 0 : RESULT_SCALE;
+            break;
+        }
+        const int ours = field[us][pos.pawn[us]], theirs = field[~us][pos.pawn[~us]];
+        // walls are what decides a race; without them the side to move wins ties
+        if (pos.num_walls[WHITE] == 0 && pos.num_walls[BLACK] == 0) {
+            result = (ours <= theirs) == (us == start) ? RESULT_SCALE : 0;
+            break;
+        }
+        if (plies == PLAYOUT_PLIES) {
+            const double p = 1 / (1 + std::exp(-eval(pos) / EVAL_SCALE));
+            result = int(std::lround(RESULT_SCALE * (us == start ? p : 1 - p)));
+            break;
+        }
+
+        Move m = MOVE_NONE;
+        if (pos.num_walls[us] && rng.below(100) < (theirs <= ours ? 40 : 10))
+            m = playout_wall(pos, field[~us], rng);
+        if (m.is_none())
+            m = playout_pawn_move(pos, field[us], rng);
+
+        pos.do_move(m);
+        played[plies++] = m;
+        if (m.type != PAWN) {
+            distance_field(pos, WHITE, field[WHITE]);
+            distance_field(pos, BLACK, field[BLACK]);
+        }
+    }
+
+    while (plies)
+        pos.undo_move(played[--plies]);
+    return result;
+}
+
+}
+
+MctsTree::MctsTree(size_t size_mb) { resize(size_mb); }
+
+void MctsTree::resize(size_t size_mb) {
+    capacity = uint32_t(std::min<size_t>(std::max<size_t>(1, size_mb * 1024 * 1024 / sizeof(MctsNode)), NO_NODE - 1));
+    nodes.reset(new MctsNode[capacity]);
+    clear();
+}
+
+void MctsTree::clear() {
+    used = 0;
+    root_pos.reset();
+}
+
+uint32_t MctsTree::allocate(uint32_t count) {
+    if (used.load(std::memory_order_relaxed) + count > capacity)
+        return NO_NODE;
+    const uint32_t at = used.fetch_add(count, std::memory_order_relaxed);
+    return at + count <= capacity ? at : NO_NODE;
+}
+
+static void init_node(MctsNode& n, Move m, float prior) {
+    n.move = m;
+    n.prior = prior;
+    n.visits.store(0, std::memory_order_relaxed);
+    n.wins.store(0, std::memory_order_relaxed);
+    n.first_child.store(NO_NODE, std::memory_order_relaxed);
+    n.num_children.store(0, std::memory_order_relaxed);
+    n.state.store(UNEXPANDED, std::memory_order_relaxed);
+}
+
+void MctsTree::set_root(const Position& pos) {
+    // reused subtrees keep their nodes where they are, so the arena only ever fills
+    if (root_pos && used.load() < capacity / 4 * 3) {
+        if (root_key == pos.key)
+            return;
+
+        Position p = *root_pos;
+        auto child_with_key = [&](uint32_t parent, uint64_t key) {
+            const MctsNode& n = nodes[parent];
+            if (n.state.load(std::memory_order_acquire) != EXPANDED)
+                return NO_NODE;
+            const uint32_t first = n.first_child.load(std::memory_order_relaxed);
+            for (uint32_t c = first; c < first + n.num_children.load(std::memory_order_relaxed); ++c) {
+                p.do_move(nodes[c].move);
+                const bool found = p.key == key;
+                p.undo_move(nodes[c].move);
+                if (found)
+                    return c;
+            }
+            return NO_NODE;
+        };
+
+        uint32_t found = child_with_key(root, pos.key);
+        const MctsNode& r = nodes[root];
+        if (found == NO_NODE && r.state.load(std::memory_order_acquire) == EXPANDED) {
+            const uint32_t first = r.first_child.load(std::memory_order_relaxed);
+            for (uint32_t c = first; found == NO_NODE && c < first + r.num_children.load(); ++c) {
+                p.do_move(nodes[c].move);
+                found = child_with_key(c, pos.key);
+                p.undo_move(nodes[c].move);
+            }
+        }
+        if (found != NO_NODE) {
+            root = found;
+            root_key = pos.key;
+            *root_pos = pos;
+            return;
+        }
+    }
+
+    clear();
+    root = allocate(1);
+    init_node(nodes[root], MOVE_NONE, 1.0f);
+    root_pos.reset(new Position(pos));
+    root_key = pos.key;
+}
+
+bool MctsTree::expand(uint32_t node, const Position& pos) {
+    MctsNode& n = nodes[node];
+    uint8_t expected = UNEXPANDED;
+    if (!n.state.compare_exchange_strong(expected, EXPANDING, std::memory_order_acquire))
+        return false;
+
+    const MoveList list(pos);
+    const uint32_t first = allocate(uint32_t(list.size()));
+    if (first == NO_NODE || list.empty()) {
+        n.state.store(UNEXPANDED, std::memory_order_release);
+        return false;
+    }
+
+    // Priors: steps down our shortest path, walls across the opponent's, most of
+    // all near their pawn
+    const Color us = pos.side_to_move;
+    uint8_t ours[SQ_NB], theirs[SQ_NB];
+    distance_field(pos, us, ours);
+    distance_field(pos, ~us, theirs);
+    float weights[256];
+    float total = 0;
+    int i = 0;
+    for (Move m : list) {
+        float w;
+        if (m.type == PAWN)
+            w = ours[m.to] < ours[m.from] ? 4.0f : 0.5f;
+        else {
+            const int c = cuts(theirs, m);
+            w = c ? float(c) : 0.1f;
+            if (c && manhattan(m.from, pos.pawn[~us]) <= 2)
+                w *= 2;
+        }
+        weights[i++] = w;
+        total += w;
+    }
+
+    i = 0;
+    for (Move m : list) {
+        init_node(nodes[first + i], m, weights[i] / total);
+        ++i;
+    }
+    n.first_child.store(first, std::memory_order_relaxed);
+    n.num_children.store(uint16_t(list.size()), std::memory_order_relaxed);
+    n.state.store(EXPANDED, std::memory_order_release);
+    return true;
+}
+
+uint32_t MctsTree::select(uint32_t node) const {
+    const MctsNode& n = nodes[node];
+    const int parent_visits = std::max(1, n.visits.load(std::memory_order_relaxed));
+    // the node's wins are for the side that moved into it, its children's for the other
+    const float parent_q = float(n.wins.load(std::memory_order_relaxed)) / (RESULT_SCALE * parent_visits);
+    const float fpu = std::max(0.0f, 1 - parent_q - FPU_REDUCTION);
+    const float scale = C_PUCT * std::sqrt(float(parent_visits));
+
+    const uint32_t first = n.first_child.load(std::memory_order_relaxed);
+    const uint32_t last = first + n.num_children.load(std::memory_order_relaxed);
+    uint32_t best = first;
+    float best_score = -1;
+    for (uint32_t c = first; c < last; ++c) {
+        const int visits = nodes[c].visits.load(std::memory_order_relaxed);
+        const float q = visits ? float(nodes[c].wins.load(std::memory_order_relaxed)) / (RESULT_SCALE * visits) : fpu;
+        const float score = q + scale * nodes[c].prior / (1 + visits);
+        if (score > best_score) {
+            best_score = score;
+            best = c;
+        }
+    }
+    return best;
+}
+
+void MctsTree::worker(const Position& root_pos, int thread_id) {
+    Position pos = root_pos;
+    Rng rng(thread_id + 1);
+    uint32_t path[MAX_PATH];
+
+    const long long playout_limit = limits->nodes ? limits->nodes
+                                  : time->hard_limit() ? 0 : DEFAULT_PLAYOUTS;
+    const int time_limit = time->soft_limit();
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        int len = 0;
+        uint32_t n = root;
+        path[len++] = n;
+        nodes[n].visits.fetch_add(1, std::memory_order_relaxed);
+
+        // Down the tree; each visit counts as a loss until the result comes back
+        while (len < MAX_PATH && nodes[n].state.load(std::memory_order_acquire) == EXPANDED
+               && !pos.is_terminal()) {
+            n = select(n);
+            nodes[n].visits.fetch_add(1, std::memory_order_relaxed);
+            pos.do_move(nodes[n].move);
+            path[len++] = n;
+        }
+
+        if (len < MAX_PATH && !pos.is_terminal() && nodes[n].visits.load(std::memory_order_relaxed) >= EXPAND_VISITS
+            && expand(n, pos)) {
+            n = select(n);
+            nodes[n].visits.fetch_add(1, std::memory_order_relaxed);
+            pos.do_move(nodes[n].move);
+            path[len++] = n;
+        }
+
+        // for the side to move at the leaf, whose opponent played into it
+        const int result = pos.is_terminal() ? 0 : playout(pos, rng);
+        int v = RESULT_SCALE - result;
+        for (int i = len - 1; i >= 0; --i) {
+            nodes[path[i]].wins.fetch_add(v, std::memory_order_relaxed);
+            v = RESULT_SCALE - v;
+        }
+        for (int i = len - 1; i > 0; --i)
+            pos.undo_move(nodes[path[i]].move);
+
+        int deepest = max_depth.load(std::memory_order_relaxed);
+        while (len - 1 > deepest && !max_depth.compare_exchange_weak(deepest, len - 1)) {}
+
+        const long long done = playouts.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (playout_limit && done >= playout_limit)
+            stop = true;
+        if (thread_id == 0 && (done & 15) == 0
+            && ((time_limit && time->elapsed() >= time_limit)
+                || (limits->abort && limits->abort->load(std::memory_order_relaxed))))
+            stop = true;
+    }
+}
+
+int MctsTree::search(const Position& pos, const SearchLimits& search_limits, int threads, Move& best_move) {
+    set_root(pos);
+    last = MctsStats{};
+    last.reused = uint32_t(nodes[root].visits.load());
+
+    TimeManager tm(search_limits, pos);
+    limits = &search_limits;
+    time = &tm;
+    stop = false;
+    playouts = 0;
+    max_depth = 0;
+
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < threads; ++i)
+        helpers.emplace_back([this, &pos, i] { worker(pos, i); });
+    worker(pos, 0);
+    for (std::thread& t : helpers)
+        t.join();
+
+    // Most visited child; a search too short to expand the root goes by the priors
+    const MctsNode& r = nodes[root];
+    if (r.state.load() != EXPANDED)
+        expand(root, pos);
+    best_move = MOVE_NONE;
+    int score = 0;
+    if (r.state.load() == EXPANDED) {
+        const uint32_t first = r.first_child.load();
+        uint32_t best = first;
+        for (uint32_t c = first; c < first + r.num_children.load(); ++c) {
+            const MctsNode& b = nodes[best];
+            const MctsNode& n = nodes[c];
+            if (std::make_tuple(n.visits.load(), n.wins.load(), n.prior)
+                > std::make_tuple(b.visits.load(), b.wins.load(), b.prior))
+                best = c;
+        }
+        best_move = nodes[best].move;
+        const int visits = nodes[best].visits.load();
+        if (visits)
+            score = int(std::lround(1000.0 * (2.0 * nodes[best].wins.load() / (RESULT_SCALE * visits) - 1)));
+    }
+
+    last.playouts = playouts;
+    last.max_depth = max_depth;
+    last.nodes_used = std::min(used.load(), capacity);
+    limits = nullptr;
+    time = nullptr;
+    return score;
+}
+
+void MctsTree::print_stats() const {
+    std::cout << "MCTS: " << last.playouts << " playouts, depth " << last.max_depth
+              << ", " << last.reused << " root visits reused, arena "
+              << 1000ULL * last.nodes_used / capacity / 10.0 << "% full\n";
+}
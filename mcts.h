@@ -0,0 +1,83 @@
+#pragma once
+
+#include "position.h"
+#include "timeman.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Monte Carlo tree search (PUCT), the alternative to iterative_deepening's
+// alpha-beta; search_options.mcts switches iterative_deepening over to it.
+//
+// Nodes live in one preallocated arena and a node's children are a contiguous
+// block of it, handed out with an atomic bump pointer. Threads share the tree:
+// a node's visit count goes up on the way down, which counts the playout under
+// way as a loss (virtual loss) until its result comes back up. Children get a
+// prior from cheap move features (steps down our shortest path, walls across the
+// opponent's), and a node is only expanded after a few visits.
+// Playouts step down the shortest path and now and then drop a wall across the
+// opponent's. They are short: after a few plies eval() is turned into a win rate
+// (long random games are mostly noise), and once both sides are out of walls the
+// closer pawn wins.
+// The tree is kept between searches: a root one or two plies below the last one
+// keeps its subtree, until the arena runs low and everything is thrown away.
+// Searches end on time or on limits.nodes playouts; limits.depth is an alpha-beta
+// limit and is ignored here.
+
+struct MctsNode {
+    Move move;                          // the move leading here
+    float prior;
+    std::atomic<int32_t> visits;
+    std::atomic<int64_t> wins;          // RESULT_SCALE per playout won, for the side that played move
+    std::atomic<uint32_t> first_child;
+    std::atomic<uint16_t> num_children;
+    std::atomic<uint8_t> state;         // UNEXPANDED, EXPANDING or EXPANDED
+};
+
+struct MctsStats {
+    long long playouts = 0;
+    int max_depth = 0;
+    uint32_t nodes_used = 0;            // arena nodes in use at the end
+    uint32_t reused = 0;                // root visits carried over from the last search
+};
+
+class MctsTree {
+public:
+    explicit MctsTree(size_t size_mb = 64);
+
+    void resize(size_t size_mb);
+    void clear();
+
+    // Best move by visits; the score is the win rate scaled to -1000..1000
+    int search(const Position& pos, const SearchLimits& limits, int threads, Move& best_move);
+    const MctsStats& stats() const { return last; }
+    // where the tree is rooted, null before the first search
+    const Position* root_position() const { return root_pos.get(); }
+    void print_stats() const;
+
+private:
+    uint32_t allocate(uint32_t count);
+    // finds pos one or two plies below the current root, else starts over
+    void set_root(const Position& pos);
+    bool expand(uint32_t node, const Position& pos);
+    uint32_t select(uint32_t node) const;
+    void worker(const Position& root_pos, int thread_id);
+
+    std::unique_ptr<MctsNode[]> nodes;
+    uint32_t capacity = 0;
+    std::atomic<uint32_t> used{0};
+
+    uint32_t root = 0;
+    uint64_t root_key = 0;
+    std::unique_ptr<Position> root_pos;
+
+    // the current search
+    const SearchLimits* limits = nullptr;
+    TimeManager* time = nullptr;
+    std::atomic<bool> stop{false};
+    std::atomic<long long> playouts{0};
+    std::atomic<int> max_depth{0};
+    MctsStats last;
+};
+
+extern MctsTree Mcts;
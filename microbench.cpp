@@ -0,0 +1,307 @@
+// Micro-benchmarks of the core kernels over a fixed corpus of positions, to catch
+// performance regressions between builds. Each kernel runs over each group of
+// positions: rounds are doubled until a repetition takes a few milliseconds,
+// a couple of repetitions warm up, and the statistics come from the rest.
+// Results can be written as tab-separated values and two such files compared.
+//
+//   make bench                              (writes bench_results.tsv)
+//   ./microbench --reps 21 --filter eval --out new.tsv
+//   ./microbench --compare bench_results.tsv new.tsv
+
+#include "position.h"
+#include "movegen.h"
+#include "search.h"
+#include "engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Games from the start position in engine notation, grouped by the kind of
+// position they end in; the walls games end with 14 or 15 walls down and both
+// sides still holding some. Never change them: results are only comparable over
+// the same corpus.
+struct CorpusGroup {
+    const char* name;
+    std::vector<const char*> games;
+};
+
+const CorpusGroup CORPUS[] = {
+    {"opening", {
+        "e1f1 e9e8 f1f2 a8v",
+        "e1e2 e9e8 e3v e8e7 e2e3 e8v",
+        "e1e2 e9e8 e2e3 e8f8 e3e4 f8f7 e4e5 f7e7",
+    }},
+    {"midgame", {
+        "c5v e9e8 d7h e8e7 e1e2 e7f7 e2e3 h2v a2h h8h e3d3 f2h d3d4 f7f6 e5v f9h d4d5 f7v",
+        "e1f1 e9f9 f1f2 b8v f2f3 f9e9 f3f4 d9h f4g4 e9f9 g4g3 b2v e3h f9f8 g3g4 f8g8 g4g5 f9v g5g4 g8g7",
+        "e1d1 e9e8 d1c1 e6v c1c2 e8e7 c2c3 e7e6 h9v e6e5 c3d3 e5e4 d3d4 e4e3 d4d5 e3e2 d5d6 d3v d6d7",
+    }},
+    {"walls", {
+        "e1e2 e8v e2e3 e9e8 h3v d2v d7v c3v e3e4 h7h g9v c2h b5v c6v d4h b4h g6h b9h a4v",
+        "h4v e9e8 h8v e8e7 g2h f9v g3h d2h a3h e7f7 e1f1 f8h e7v f7f6 f1f2 f6f5 a6v g9h b2h c2v b7h "
+        "f5f4",
+        "d7h b8h g2h g3h c3h e9f9 c8v d4v d9v b3v b7v a5v h2v f6h d6h f9g9 a7h g9g8",
+    }},
+    {"endgame", {
+        "d5v b2h f2v e9e8 a5v g7v e1e2 h5v h6h e8e7 a7v b7v d9h d2h b4h f4h c6v d8v e2e3 h4h a6h "
+        "e7e6 e6v e6e5 e3e4 e5e3 e4f4 e3f3 f4f5 c3h f5f6 f8h f6f7 f3f2 f7f6",
+        "d6h b5v f9h a3v e1f1 h6v e4v e9e8 f1g1 e8f8 d2v f8f7 a7h f7f6 g1h1 f6f5 h5h f5f4 h1g1 "
+        "f4f3 g3h f3f2 b4h f2e2 g1g2",
+        "d8h e9e8 e2h f3v b6v a7v h8v e8f8 e1d1 f8g8 d1d2 g8g7 b8v g7g6 a4v g6g5 d2c2 g5g4 c2c3 "
+        "g2h f5h g4h4 b4h d6v c3d3 g4v c3v h4h3 c9v e7v d3d4 h3h2 d4c4 h2i2 c4c5",
+    }},
+};
+
+struct Result {
+    std::string kernel, group;
+    long long ops = 0;          // kernel calls per repetition
+    double median = 0, min = 0, mean = 0, stddev = 0;   // ns per call
+};
+
+struct BenchConfig {
+    int reps = 11;
+    int warmup = 2;
+    double rep_ms = 5;          // shortest repetition the rounds are doubled to
+    std::string filter;         // kernels whose name contains it
+    std::string out;
+};
+
+// Keeps results alive so the compiler can't drop the work
+volatile long long sink;
+
+bool replay(const char* game, Position& pos) {
+    pos = Position();
+    std::istringstream is(game);
+    std::string token;
+    while (is >> token) {
+        const Move m = parse_move(pos, token);
+        if (m.is_none())
+            return false;
+        pos.do_move(m);
+    }
+    return true;
+}
+
+// run(rounds) does rounds passes over the group and returns the calls it made
+Result measure(const std::string& kernel, const std::string& group, const BenchConfig& config,
+               const std::function<long long(int)>& run) {
+    using clock = std::chrono::steady_clock;
+    auto timed = [&](int rounds, long long& ops) {
+        const auto start = clock::now();
+        ops = run(rounds);
+        return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    };
+
+    long long ops = 0;
+    int rounds = 1;
+    while (timed(rounds, ops) < config.rep_ms * 1e6 && rounds < (1 << 24))
+        rounds *= 2;
+    for (int i = 0; i < config.warmup; ++i)
+        timed(rounds, ops);
+
+    std::vector<double> samples;
+    for (int i = 0; i < config.reps; ++i) {
+        const double ns = timed(rounds, ops);
+        samples.push_back(ns / ops);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    Result r{kernel, group, ops};
+    r.median = samples[samples.size() / 2];
+    r.min = samples.front();
+    for (double s : samples)
+        r.mean += s / samples.size();
+    for (double s : samples)
+        r.stddev += (s - r.mean) * (s - r.mean) / samples.size();
+    r.stddev = std::sqrt(r.stddev);
+    return r;
+}
+
+std::vector<Result> run_benchmarks(const BenchConfig& config) {
+    std::vector<Result> results;
+    for (const CorpusGroup& group : CORPUS) {
+        std::vector<Position> positions(group.games.size());
+        std::vector<std::vector<Move>> moves;   // MoveList points into itself, so can't be copied
+        std::vector<DistanceFields> fields(group.games.size());
+        for (size_t i = 0; i < group.games.size(); ++i) {
+            if (!replay(group.games[i], positions[i])) {
+                std::cout << "Corpus game does not replay: " << group.games[i] << "\n";
+                std::exit(1);
+            }
+            const MoveList legal(positions[i]);
+            moves.emplace_back(legal.begin(), legal.end());
+            fields[i].init(positions[i]);
+        }
+
+        const std::pair<const char*, std::function<long long(int)>> kernels[] = {
+            {"generate", [&](int rounds) {
+                long long n = 0;
+                for (int r = 0; r < rounds; ++r)
+                    for (const Position& pos : positions)
+                        n += MoveList(pos).size();
+                sink = n;
+                return (long long)rounds * positions.size();
+            }},
+            {"generate_wall_moves", [&](int rounds) {
+                Move list[256];
+                long long n = 0;
+                for (int r = 0; r < rounds; ++r)
+                    for (const Position& pos : positions)
+                        n += generate_wall_moves(pos, list) - list;
+                sink = n;
+                return (long long)rounds * positions.size();
+            }},
+            {"reachable_any_goal", [&](int rounds) {
+                long long n = 0;
+                for (int r = 0; r < rounds; ++r)
+                    for (const Position& pos : positions)
+                        for (Color c : {WHITE, BLACK})
+                            n += reachable_any_goal(pos, pos.pawn[c], GoalMask[c]);
+                sink = n;
+                return 2LL * rounds * positions.size();
+            }},
+            {"distance_to_goal", [&](int rounds) {
+                long long n = 0;
+                for (int r = 0; r < rounds; ++r)
+                    for (const Position& pos : positions)
+                        for (Color c : {WHITE, BLACK})
+                            n += distance_to_goal(pos, c);
+                sink = n;
+                return 2LL * rounds * positions.size();
+            }},
+            // as at a search leaf, with the distance maps kept up to date
+            {"eval", [&](int rounds) {
+                long long n = 0;
+                for (int r = 0; r < rounds; ++r)
+                    for (size_t i = 0; i < positions.size(); ++i)
+                        n += eval(positions[i], fields[i]);
+                sink = n;
+                return (long long)rounds * positions.size();
+            }},
+            // every legal move made and taken back
+            {"do_undo_move", [&](int rounds) {
+                long long n = 0, ops = 0;
+                for (int r = 0; r < rounds; ++r)
+                    for (size_t i = 0; i < positions.size(); ++i)
+                        for (Move m : moves[i]) {
+                            positions[i].do_move(m);
+                            n += positions[i].key & 1;
+                            positions[i].undo_move(m);
+                            ++ops;
+                        }
+                sink = n;
+                return ops;
+            }},
+        };
+
+        for (const auto& [name, run] : kernels) {
+            if (std::string(name).find(config.filter) == std::string::npos)
+                continue;
+            results.push_back(measure(name, group.name, config, run));
+            const Result& r = results.back();
+            std::cout << std::left << std::setw(20) << r.kernel << std::setw(9) << r.group << std::right
+                      << std::fixed << std::setprecision(1)
+                      << "  median " << std::setw(9) << r.median << " ns"
+                      << "  min " << std::setw(9) << r.min
+                      << "  stddev " << std::setw(7) << r.stddev << "\n";
+        }
+    }
+    return results;
+}
+
+bool write_results(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream file(path, std::ios::trunc);
+    file << "kernel\tgroup\tops\tmedian_ns\tmin_ns\tmean_ns\tstddev_ns\n";
+    for (const Result& r : results)
+        file << r.kernel << '\t' << r.group << '\t' << r.ops << '\t' << r.median << '\t'
+             << r.min << '\t' << r.mean << '\t' << r.stddev << '\n';
+    return bool(file);
+}
+
+// kernel/group -> median
+std::map<std::string, double> read_medians(const std::string& path) {
+    std::map<std::string, double> medians;
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line)) {
+        std::istringstream is(line);
+        std::string kernel, group;
+        long long ops;
+        double median;
+        if (std::getline(is, kernel, '\t') && std::getline(is, group, '\t') && is >> ops >> median)
+            medians[kernel + "/" + group] = median;
+    }
+    return medians;
+}
+
+int compare(const std::string& before_path, const std::string& after_path) {
+    const auto before = read_medians(before_path), after = read_medians(after_path);
+    if (before.empty() || after.empty()) {
+        std::cout << "Could not read " << (before.empty() ? before_path : after_path) << "\n";
+        return 1;
+    }
+    std::cout << std::fixed << std::setprecision(1);
+    for (const auto& [key, old_ns] : before) {
+        const auto it = after.find(key);
+        if (it == after.end())
+            continue;
+        std::cout << std::left << std::setw(30) << key << std::right << std::setw(10) << old_ns
+                  << " -> " << std::setw(10) << it->second << " ns  "
+                  << std::showpos << (it->second / old_ns - 1) * 100 << std::noshowpos << "%\n";
+    }
+    return 0;
+}
+
+void usage() {
+    std::cout << "usage: microbench [--reps N] [--warmup N] [--rep-ms MS] [--filter KERNEL] [--out FILE]\n"
+                 "       microbench --compare BEFORE AFTER\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--compare" && i + 2 < argc)
+            return compare(argv[i + 1], argv[i + 2]);
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (!ok) {}
+        else if (arg == "--reps") config.reps = std::max(1, std::stoi(value));
+        else if (arg == "--warmup") config.warmup = std::max(0, std::stoi(value));
+        else if (arg == "--rep-ms") config.rep_ms = std::stod(value);
+        else if (arg == "--filter") config.filter = value;
+        else if (arg == "--out") config.out = value;
+        else ok = false;
+        if (!ok) {
+            usage();
+            return 1;
+        }
+        ++i;
+    }
+
+#if BOARD_SIZE != 9
+    std::cout << "The corpus is made of 9x9 games; build with the default BOARD_SIZE\n";
+    return 1;
+#endif
+    init();
+    const std::vector<Result> results = run_benchmarks(config);
+    if (!config.out.empty() && !write_results(config.out, results)) {
+        std::cout << "Could not write " << config.out << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "movegen.h"
+#include "stats.h"
 
 // Forward declarations for helper functions
 inline bool has_wall_between(const Position& pos, Square s1, Square s2);
@@ -11,78 +12,56 @@ Move* generate(const Position& pos, Move* moveList) {
 }
 
 Move* generate_pawn_moves(const Position& pos, Move* moveList) {
+    STATS_TIMER(movegen_ns);
     Color us = pos.side_to_move;
     Square us_sq = pos.pawn[us];
-    Square them_sq = pos.pawn[~us];
-    
-    Bitboard moves_bb = Bitboard{0ULL, 0ULL};
-    Bitboard all_pawns = square_bb(us_sq) | square_bb(them_sq);
-
-    // 1. Generate standard cardinal moves, excluding squares occupied by pawns.
-    Bitboard attacks = PawnAttacks[us_sq] & ~all_pawns;
-
-    // 2. Check for opponent adjacency to handle jumps.
-    if (PawnAttacks[us_sq] & them_sq) {
-        Direction dir = Direction(them_sq - us_sq);
-
-        // If there's a wall between us and them, we can't jump.
-        if (!has_wall_between(pos, us_sq, them_sq)) {
-            Square jump_sq = them_sq + dir;
-
-            // 3. Try to generate a straight jump.
-            // Check if jump is on board and not blocked by a wall behind the opponent.
-            if ((PawnAttacks[them_sq] & jump_sq) && !has_wall_between(pos, them_sq, jump_sq)) {
-                moves_bb |= square_bb(jump_sq);
-            } 
-            // 4. If straight jump is not possible, generate diagonal jumps.
-            else {
-                // Get directions perpendicular to the opponent's direction
-                Direction d1 = (dir == NORTH || dir == SOUTH) ? EAST : NORTH;
-                Direction d2 = (dir == NORTH || dir == SOUTH) ? WEST : SOUTH;
-
-                Square diag1 = them_sq + d1;
-                Square diag2 = them_sq + d2;
-
-                // Check diagonal 1: must be on board and no wall from opponent
-                if ((PawnAttacks[them_sq] & diag1) && !has_wall_between(pos, them_sq, diag1)) {
-                    moves_bb |= square_bb(diag1);
-                }
-                // Check diagonal 2: must be on board and no wall from opponent
-                if ((PawnAttacks[them_sq] & diag2) && !has_wall_between(pos, them_sq, diag2)) {
-                    moves_bb |= square_bb(diag2);
-                }
-            }
-        }
-    }
 
-    // 5. Add standard moves that are not blocked by walls.
-    Bitboard potential_moves = attacks;
-    while (potential_moves) {
-        Square to = pop_lsb(potential_moves);
-        if (!has_wall_between(pos, us_sq, to)) {
-            moves_bb |= square_bb(to);
-        }
-    }
-
-    // Remove any moves that would land on the other pawn (can happen with diagonal 'jumps')
-    // dont think this is possible
-    moves_bb &= ~square_bb(them_sq);
+    Bitboard moves_bb = pawn_targets(Passable(pos), us_sq, pos.pawn[~us]);
 
     moveList = splat_pawn_moves(moveList, us_sq, moves_bb);
 
     return moveList;
 }
 
+Bitboard pawn_targets(const Passable& passable, Square us_sq, Square them_sq) {
+    int us_exits = passable.exits(us_sq);
+    int them_exits = passable.exits(them_sq);
+
+    // Direction to an adjacent opponent, collapsed to NO_DIRECTION when there is
+    // none or a wall sits between the pawns, so we never jump through a wall
+    int dir = PawnAdjacency[us_sq][them_sq];
+    int blocked = ((us_exits >> dir) & 1) ^ 1;
+    dir += (NO_DIRECTION - dir) * blocked;
+
+    return (PawnSteps[us_sq][us_exits] & ~square_bb(them_sq))
+         | PawnJumps[them_sq][dir][them_exits];
+}
+
 Move* generate_wall_moves(const Position& pos, Move* moveList) {
+    STATS_TIMER(movegen_ns);
     Color us = pos.side_to_move;
 
     uint16_t our_walls = pos.num_walls[us];
     if (our_walls == 0)
         return moveList;
 
-    Bitboard h_walls = Bitboard{0ULL, 0ULL};
-    Bitboard v_walls = Bitboard{0ULL, 0ULL};
-    
+    // only walls closing a loop in the wall chains can cut a pawn off its goal
+    Bitboard h_walls = pos.h_walls_closing;
+    Bitboard v_walls = pos.v_walls_closing;
+    STATS_ADD(walls_path_checked, popcount(h_walls) + popcount(v_walls));
+    STATS_ADD(wall_candidates, popcount(h_walls | pos.h_walls_free) + popcount(v_walls | pos.v_walls_free));
+    remove_blocking_walls(pos, h_walls, v_walls);
+    h_walls |= pos.h_walls_free;
+    v_walls |= pos.v_walls_free;
+    STATS_ADD(walls_accepted, popcount(h_walls) + popcount(v_walls));
+
+    moveList = splat_wall_moves(moveList, h_walls, H_WALL);
+    moveList = splat_wall_moves(moveList, v_walls, V_WALL);
+
+    return moveList;
+}
+
+void pseudo_legal_walls(const Position& pos, Bitboard& h_walls, Bitboard& v_walls) {
     // cant place wall where there is already a wall AND there has to be at least 2 squares of space
     h_walls = ~(pos.h_walls_full | shift<WEST>(pos.h_walls_full));
     // cannot place a wall in between a vertical wall
@@ -96,9 +75,205 @@ Move* generate_wall_moves(const Position& pos, Move* moveList) {
     // but can place walls after a horizontal wall segment ; making a T shape
     v_walls &= ~(pos.h_walls_idxs);
     v_walls &= ValidWalls;
-    
-    // TODO ; we also cannot place a wall that completely blocks a player from reaching their goal
-    // naive implementation is to just test each wall placement and see if both players can still reach their goal 
+}
+
+// Cut detection on the passage graph.
+// A BFS spanning tree is grown from the goal row, one whole layer per step. Every
+// non-tree edge gets a random key and every tree edge the XOR of the keys of the
+// non-tree edges leaving its subtree. The keys of any edge cut XOR to zero, so a
+// wall's two edges only form a cut if one has key 0 (a bridge) or both share a key.
+// Which side of such a cut the pawn lands on follows from its tree path to the goal,
+// so only walls that really cut the pawn off are confirmed with a flood fill and
+// everything else is legal without any search.
+namespace {
+
+// edges are named by their south/west square: north edges 0..80, east edges 81..161
+constexpr int north_edge(Square s) { return s; }
+constexpr int east_edge(Square s) { return SQ_NB + s; }
+
+// edge between s and s + Cardinals[i]
+constexpr int EdgeBase[4] = {0, 0, SQ_NB, SQ_NB};
+constexpr int EdgeOffset[4] = {0, SOUTH, 0, WEST};
+
+constexpr uint64_t edge_key(int e) {
+    // splitmix64, odd so a non-tree edge never looks like a bridge
+    uint64_t z = uint64_t(e + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (z ^ (z >> 31)) | 1;
+}
+
+struct CutKeys {
+    uint64_t key[2 * SQ_NB];
+    Bitboard component;   // squares connected to the goal
+    Bitboard path_north;  // north edges on the tree path from the pawn to the goal
+    Bitboard path_east;   // east edges on that path
+
+    CutKeys(const Passable& passable, Bitboard goal, Square start) {
+        // up[i] holds the squares whose tree parent is one step towards Cardinals[i]
+        Bitboard up[4] = {};
+        Bitboard layers[SQ_NB + 1];
+        uint64_t sub[SQ_NB] = {};
+        int depth = 0;
+
+        layers[0] = component = goal;
+        for (Bitboard frontier = goal; frontier; ) {
+            Bitboard from_south = shift<NORTH>(frontier & passable.north) & ~component;
+            Bitboard from_north = shift<SOUTH>(frontier & passable.south) & ~component & ~from_south;
+            component |= from_south | from_north;
+            Bitboard from_west = shift<EAST>(frontier & passable.east) & ~component;
+            component |= from_west;
+            Bitboard from_east = shift<WEST>(frontier & passable.west) & ~component;
+            component |= from_east;
+
+            up[0] |= from_north;
+            up[1] |= from_south;
+            up[2] |= from_east;
+            up[3] |= from_west;
+            frontier = from_south | from_north | from_west | from_east;
+            layers[++depth] = frontier;
+        }
+
+        // key the non-tree edges; edges inside the goal row only touch roots and are harmless
+        Bitboard tree_north = up[0] | shift<SOUTH>(up[1]);
+        Bitboard tree_east = up[2] | shift<WEST>(up[3]);
+
+        Bitboard b = passable.north & component & ~tree_north;
+        while (b) {
+            Square s = pop_lsb(b);
+            uint64_t k = key[north_edge(s)] = edge_key(north_edge(s));
+            sub[s] ^= k;
+            sub[s + NORTH] ^= k;
+        }
+        b = passable.east & component & ~tree_east;
+        while (b) {
+            Square s = pop_lsb(b);
+            uint64_t k = key[east_edge(s)] = edge_key(east_edge(s));
+            sub[s] ^= k;
+            sub[s + EAST] ^= k;
+        }
+
+        // tree edges take the XOR of their subtree, deepest layer first
+        for (int d = depth - 1; d > 0; --d) {
+            b = layers[d];
+            while (b) {
+                Square v = pop_lsb(b);
+                int i = parent_direction(up, v);
+                key[EdgeBase[i] + v + EdgeOffset[i]] = sub[v];
+                sub[v + Cardinals[i]] ^= sub[v];
+            }
+        }
+
+        path_north = path_east = Bitboard{};
+        if (!(component & start))
+            return;
+
+        for (Square v = start; !(goal & v); ) {
+            int i = parent_direction(up, v);
+            Square e = Square(v + EdgeOffset[i]);
+            if (EdgeBase[i])
+                path_east |= e;
+            else
+                path_north |= e;
+            v = v + Cardinals[i];
+        }
+    }
+
+    static int parent_direction(const Bitboard up[4], Square v) {
+        return bit_at(up[1], v) | bit_at(up[2], v) << 1 | (bit_at(up[3], v) * 3);
+    }
+
+    // Could removing edges e1 and e2 (has* = edge currently open, on* = edge on the
+    // pawn's tree path) separate the pawn from the goal? A bridge cuts off the subtree
+    // under it, and two edges with equal keys cut off whatever lies between them,
+    // which holds the pawn iff exactly one of them is on its path.
+    bool may_cut(int e1, bool has1, bool on1, int e2, bool has2, bool on2) const {
+        return (has1 && on1 && !key[e1]) || (has2 && on2 && !key[e2])
+            || (has1 && has2 && on1 != on2 && key[e1] == key[e2]);
+    }
+};
+
+// Drops walls from h_walls/v_walls that leave no path from start to goal
+void remove_blocking_walls(const Position& pos, const Passable& passable, Square start, Bitboard goal,
+                           Bitboard& h_walls, Bitboard& v_walls) {
+    const CutKeys cuts(passable, goal, start);
+
+    if (!(cuts.component & start)) {
+        h_walls = v_walls = Bitboard{};
+        return;
+    }
+
+    const Bitboard north = passable.north & cuts.component;
+    const Bitboard east = passable.east & cuts.component;
+
+    // a horizontal wall at s cuts the north edges of s + SOUTH and s + SOUTH_EAST,
+    // and only walls touching the pawn's path can cut it off
+    Bitboard b = h_walls & (shift<NORTH>(cuts.path_north) | shift<NORTH>(shift<WEST>(cuts.path_north)));
+    while (b) {
+        Square s = pop_lsb(b);
+        Square a = s + SOUTH, c = s + SOUTH_EAST;
+        if (cuts.may_cut(north_edge(a), bit_at(north, a), bit_at(cuts.path_north, a),
+                         north_edge(c), bit_at(north, c), bit_at(cuts.path_north, c))) {
+            Bitboard h_full = pos.h_walls_full | s | (s + EAST);
+            if (!reachable_any_goal(Passable(h_full, pos.v_walls_full), start, goal))
+                h_walls ^= s;
+        }
+    }
+
+    // a vertical wall at s cuts the east edges of s and s + SOUTH
+    b = v_walls & (cuts.path_east | shift<NORTH>(cuts.path_east));
+    while (b) {
+        Square s = pop_lsb(b);
+        Square a = s + SOUTH;
+        if (cuts.may_cut(east_edge(s), bit_at(east, s), bit_at(cuts.path_east, s),
+                         east_edge(a), bit_at(east, a), bit_at(cuts.path_east, a))) {
+            Bitboard v_full = pos.v_walls_full | s | a;
+            if (!reachable_any_goal(Passable(pos.h_walls_full, v_full), start, goal))
+                v_walls ^= s;
+        }
+    }
+}
+
+} // namespace
+
+void remove_blocking_walls(const Position& pos, Bitboard& h_walls, Bitboard& v_walls) {
+    // a handful of candidates is cheaper to flood fill one by one than to build the cut keys
+    if (popcount(h_walls) + popcount(v_walls) <= 6) {
+        Bitboard b = h_walls;
+        while (b) {
+            Square s = pop_lsb(b);
+            if (blocks_path(pos, Move{s, SQ_NONE, H_WALL}))
+                h_walls ^= s;
+        }
+        b = v_walls;
+        while (b) {
+            Square s = pop_lsb(b);
+            if (blocks_path(pos, Move{s, SQ_NONE, V_WALL}))
+                v_walls ^= s;
+        }
+        return;
+    }
+
+    const Passable passable(pos);
+    remove_blocking_walls(pos, passable, pos.pawn[WHITE], GoalMask[WHITE], h_walls, v_walls);
+    remove_blocking_walls(pos, passable, pos.pawn[BLACK], GoalMask[BLACK], h_walls, v_walls);
+}
+
+// Would this (pseudo-legal) wall cut either pawn off from its goal?
+bool blocks_path(const Position& pos, Move wall) {
+    Bitboard h_full = pos.h_walls_full, v_full = pos.v_walls_full;
+    if (wall.type == H_WALL)
+        h_full |= square_bb(wall.from) | square_bb(wall.from + EAST);
+    else
+        v_full |= square_bb(wall.from) | square_bb(wall.from + SOUTH);
+
+    const Passable passable(h_full, v_full);
+    return !reachable_any_goal(passable, pos.pawn[WHITE], GoalMask[WHITE])
+        || !reachable_any_goal(passable, pos.pawn[BLACK], GoalMask[BLACK]);
+}
+
+// One pair of flood fills per candidate, kept as the reference for remove_blocking_walls
+void remove_blocking_walls_slow(const Position& pos, Bitboard& h_walls, Bitboard& v_walls) {
     Bitboard h_walls_copy = h_walls;
     while (h_walls_copy) {
         Square wall_sq = pop_lsb(h_walls_copy);
@@ -120,11 +295,6 @@ Move* generate_wall_moves(const Position& pos, Move* moveList) {
             v_walls ^= square_bb(wall_sq); // remove this wall placement
         }
     }
-
-    moveList = splat_wall_moves(moveList, h_walls, H_WALL);
-    moveList = splat_wall_moves(moveList, v_walls, V_WALL);
-
-    return moveList;
 }
 
 // Helper to check for walls between two adjacent squares.
@@ -170,6 +340,64 @@ inline Move* splat_pawn_moves(Move* moveList, Square from, Bitboard to_bb) {
 
 // checks both white and black can still reach their goal after a wall placement
 bool reachable_any_goal(const Position& pos, Square start, Bitboard goal_mask) {
+    return reachable_any_goal(Passable(pos), start, goal_mask);
+}
+
+bool reachable_any_goal(const Passable& passable, Square start, Bitboard goal_mask) {
+    STATS_INC(bfs_calls);
+    Bitboard visited = square_bb(start);
+    Bitboard frontier = visited;
+
+    while (frontier) {
+        if (frontier & goal_mask) return true;
+        STATS_INC(bfs_layers);
+
+        frontier = passable.expand(frontier) & ~visited;
+        visited |= frontier;
+    }
+    return false;
+}
+
+
+int distance_to_goal(const Position& pos, Color c) {
+    STATS_INC(bfs_calls);
+    const Passable passable(pos);
+    Bitboard visited = square_bb(pos.pawn[c]);
+    Bitboard current_layer = visited;
+    int distance = 0;
+
+    while (current_layer) {
+        if (current_layer & GoalMask[c]) return distance;
+        STATS_INC(bfs_layers);
+
+        // TODO do we also need to check for opponent pawn? we can jump over them, decreasing the distance
+        current_layer = passable.expand(current_layer) & ~visited;
+        visited |= current_layer;
+        distance++;
+    }
+    return 500; // No path found
+}
+
+void distance_field(const Position& pos, Color c, uint8_t dist[SQ_NB]) {
+    STATS_INC(bfs_calls);
+    std::fill(dist, dist + SQ_NB, NO_PATH);
+
+    const Passable passable(pos);
+    Bitboard visited = GoalMask[c];
+    Bitboard layer = visited;
+
+    for (uint8_t d = 0; layer; ++d) {
+        STATS_INC(bfs_layers);
+        for (Bitboard b = layer; b; )
+            dist[pop_lsb(b)] = d;
+
+        layer = passable.expand(layer) & ~visited;
+        visited |= layer;
+    }
+}
+
+// Square-at-a-time reference versions, kept to validate the flood fill above
+bool reachable_any_goal_slow(const Position& pos, Square start, Bitboard goal_mask) {
     Bitboard visited = square_bb(start); // Start is visited
     Bitboard to_visit = square_bb(start);
 
@@ -190,7 +418,7 @@ bool reachable_any_goal(const Position& pos, Square start, Bitboard goal_mask) {
 }
 
 
-int distance_to_goal(const Position& pos, Color c) {
+int distance_to_goal_slow(const Position& pos, Color c) {
     Bitboard visited = square_bb(pos.pawn[c]);
     Bitboard current_layer = square_bb(pos.pawn[c]);
     int distance = 0;
@@ -198,7 +426,7 @@ int distance_to_goal(const Position& pos, Color c) {
     while (current_layer) {
         if (current_layer & GoalMask[c]) return distance;
 
-        Bitboard next_layer = Bitboard{0ULL, 0ULL};
+        Bitboard next_layer = Bitboard{};
 
         while (current_layer) {
             Square sq = pop_lsb(current_layer);
@@ -207,7 +435,6 @@ int distance_to_goal(const Position& pos, Color c) {
             while (neighbors) {
                 Square neighbor = pop_lsb(neighbors);
                 // check if the player can move to that neighbor (no wall in between)
-                // TODO do we also need to check for opponent pawn? we can jump over them, decreasing the distance
                 if (!has_wall_between(pos, sq, neighbor)) {
                     visited |= square_bb(neighbor);
                     next_layer |= square_bb(neighbor);
@@ -220,4 +447,4 @@ int distance_to_goal(const Position& pos, Color c) {
         distance++;
     }
     return 500; // No path found
-}
\ No newline at end of file
+}
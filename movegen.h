@@ -9,11 +9,54 @@
 Move* generate(const Position& pos, Move* moveList);
 Move* generate_pawn_moves(const Position& pos, Move* moveList);
 Move* generate_wall_moves(const Position& pos, Move* moveList);
+void pseudo_legal_walls(const Position& pos, Bitboard& h_walls, Bitboard& v_walls);
+void remove_blocking_walls(const Position& pos, Bitboard& h_walls, Bitboard& v_walls);
+bool blocks_path(const Position& pos, Move wall);
+void remove_blocking_walls_slow(const Position& pos, Bitboard& h_walls, Bitboard& v_walls);
 bool reachable_any_goal(const Position& pos, Square start, Bitboard goal_mask);
 bool reachable_any_goal_slow(const Position& pos, Square start, Bitboard goal_mask);
 
 
 int distance_to_goal(const Position& pos, Color c);
+int distance_to_goal_slow(const Position& pos, Color c);
+
+// Steps from every square to the goal of c, NO_PATH where it is cut off
+constexpr uint8_t NO_PATH = 255;
+void distance_field(const Position& pos, Color c, uint8_t dist[SQ_NB]);
+
+// Squares a pawn can leave in each cardinal direction without crossing a wall
+// or the board edge. Lets a BFS expand its whole frontier with four shifts.
+struct Passable {
+    Bitboard north;
+    Bitboard south;
+    Bitboard east;
+    Bitboard west;
+
+    Passable(Bitboard h_walls_full, Bitboard v_walls_full) {
+        // horizontal wall at s blocks s <-> s + SOUTH, vertical wall at s blocks s <-> s + EAST
+        north = ValidSquares & ~RankMask[RANK_LAST] & ~shift<SOUTH>(h_walls_full);
+        south = ValidSquares & ~RankMask[RANK_1] & ~h_walls_full;
+        east  = ValidSquares & ~FileMask[FILE_LAST] & ~v_walls_full;
+        west  = ValidSquares & ~FileMask[FILE_A] & ~shift<EAST>(v_walls_full);
+    }
+
+    explicit Passable(const Position& pos) : Passable(pos.h_walls_full, pos.v_walls_full) {}
+
+    // All squares one step away from any square in b
+    Bitboard expand(Bitboard b) const {
+        return shift<NORTH>(b & north) | shift<SOUTH>(b & south)
+             | shift<EAST>(b & east)   | shift<WEST>(b & west);
+    }
+
+    // 4-bit exit pattern of a square, in Cardinals order
+    int exits(Square s) const {
+        return bit_at(north, s) | bit_at(south, s) << 1 | bit_at(east, s) << 2 | bit_at(west, s) << 3;
+    }
+};
+
+bool reachable_any_goal(const Passable& passable, Square start, Bitboard goal_mask);
+// Squares the pawn on us_sq can move to, with the other pawn on them_sq
+Bitboard pawn_targets(const Passable& passable, Square us_sq, Square them_sq);
 
 Move* splat_pawn_moves(Move* moveList, Square from, Bitboard to_bb);
 Move* splat_wall_moves(Move* moveList, Bitboard wall_bb, MoveType type);
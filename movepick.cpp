@@ -0,0 +1,191 @@
+#include "movepick.h"
+#include "stats.h"
+
+namespace {
+
+constexpr int COUNTER_MOVE_BONUS = HISTORY_MAX;
+
+}
+
+void History::clear() {
+    for (auto& k : killers)
+        k[0] = k[1] = MOVE_NONE;
+    for (auto& c : counter_moves)
+        std::fill(std::begin(c), std::end(c), MOVE_NONE);
+    for (auto& by_color : scores)
+        for (auto& by_type : by_color)
+            std::fill(std::begin(by_type), std::end(by_type), 0);
+}
+
+void History::age() {
+    for (auto& k : killers)
+        k[0] = k[1] = MOVE_NONE;
+    for (auto& by_color : scores)
+        for (auto& by_type : by_color)
+            for (int& h : by_type)
+                h /= 2;
+}
+
+void History::update(Color us, Move m, Move prev, int ply, int depth, const Move* tried, int num_tried) {
+    // gravity keeps the scores within +-HISTORY_MAX
+    auto bump = [&](Move move, int bonus) {
+        int& h = scores[us][move.type][move.type == PAWN ? move.to : move.from];
+        h += bonus - h * std::abs(bonus) / HISTORY_MAX;
+    };
+
+    int bonus = std::min(depth * depth, HISTORY_MAX / 4);
+    bump(m, bonus);
+    for (int i = 0; i < num_tried; ++i)
+        bump(tried[i], -bonus);
+
+    if (killers[ply][0] != m) {
+        killers[ply][1] = killers[ply][0];
+        killers[ply][0] = m;
+    }
+
+    if (!prev.is_none())
+        counter_moves[prev.type][prev.type == PAWN ? prev.to : prev.from] = m;
+}
+
+MovePicker::MovePicker(const Position& pos, Move tt_move, const History& history, int ply, Move prev,
+                       const uint8_t* dist)
+    : pos(pos), history(history), tt_move(tt_move), dist(dist), stage(TT_STAGE) {
+    killers[0] = history.killers[ply][0];
+    killers[1] = history.killers[ply][1];
+    counter = prev.is_none() ? MOVE_NONE
+            : history.counter_moves[prev.type][prev.type == PAWN ? prev.to : prev.from];
+
+    // pawn moves are a table lookup; walls are only turned into moves at QUIET_INIT
+    Move pawn_moves[16];
+    Move* last = generate_pawn_moves(pos, pawn_moves);
+    end = moves;
+    for (Move* m = pawn_moves; m != last; ++m)
+        *end++ = ScoredMove{*m, 0};
+    cur = stage_end = moves;
+
+    h_walls = v_walls = h_unchecked = v_unchecked = Bitboard{};
+    if (pos.num_walls[pos.side_to_move]) {
+        h_unchecked = pos.h_walls_closing;
+        v_unchecked = pos.v_walls_closing;
+        h_walls = pos.h_walls_free | h_unchecked;
+        v_walls = pos.v_walls_free | v_unchecked;
+    }
+}
+
+bool MovePicker::take_wall(Move m) {
+    Bitboard& walls = m.type == H_WALL ? h_walls : v_walls;
+    Bitboard& unchecked = m.type == H_WALL ? h_unchecked : v_unchecked;
+    if (!(walls & m.from))
+        return false;
+    walls ^= m.from;
+    STATS_INC(wall_candidates);
+    if (unchecked & m.from) {
+        unchecked ^= m.from;
+        STATS_INC(walls_path_checked);
+        if (blocks_path(pos, m))
+            return false;
+    }
+    STATS_INC(walls_accepted);
+    return true;
+}
+
+bool MovePicker::hoist(Move m, int score) {
+    if (m.type == PAWN) {
+        ScoredMove* sm = std::find_if(stage_end, end, [&](const ScoredMove& x) { return x.move == m; });
+        if (sm == end)
+            return false;
+        sm->score = score;
+        std::swap(*sm, *stage_end++);
+        return true;
+    }
+    if (!take_wall(m))
+        return false;
+    *end = ScoredMove{m, score};
+    std::swap(*end++, *stage_end++);
+    return true;
+}
+
+// Swaps the best scored move of [cur, stage_end) to cur and returns it
+Move MovePicker::pick_best() {
+    ScoredMove* best = std::max_element(cur, stage_end,
+        [](const ScoredMove& a, const ScoredMove& b) { return a.score < b.score; });
+    std::swap(*best, *cur);
+    return (cur++)->move;
+}
+
+Move MovePicker::next_move() {
+    STATS_TIMER(movegen_ns);
+    switch (stage) {
+    case TT_STAGE:
+        ++stage;
+        // the hash move may come from another position sharing the key, hoist() checks it
+        if (!tt_move.is_none() && hoist(tt_move, 0))
+            return (cur++)->move;
+        [[fallthrough]];
+
+    case FORWARD_INIT: {
+        ++stage;
+        uint8_t own_dist[SQ_NB];
+        const uint8_t* d = dist;
+        if (!d) {
+            distance_field(pos, pos.side_to_move, own_dist);
+            d = own_dist;
+        }
+
+        // pawn moves that gain ground, scored by the gain
+        stage_end = cur;
+        for (ScoredMove* m = cur; m != end; ++m) {
+            if (d[m->move.to] < d[m->move.from]) {
+                m->score = d[m->move.from] - d[m->move.to];
+                std::swap(*m, *stage_end++);
+            }
+        }
+    }
+        [[fallthrough]];
+
+    case FORWARD:
+        if (cur != stage_end)
+            return pick_best();
+        ++stage;
+        [[fallthrough]];
+
+    case KILLERS_INIT:
+        ++stage;
+        stage_end = cur;
+        for (int k = 0; k < 2; ++k)
+            if (!killers[k].is_none() && killers[k] != tt_move)
+                hoist(killers[k], 2 - k);
+        [[fallthrough]];
+
+    case KILLERS:
+        if (cur != stage_end)
+            return pick_best();
+        ++stage;
+        [[fallthrough]];
+
+    case QUIET_INIT:
+        ++stage;
+        for (Bitboard b = h_walls; b; )
+            *end++ = ScoredMove{Move{pop_lsb(b), SQ_NONE, H_WALL}, 0};
+        for (Bitboard b = v_walls; b; )
+            *end++ = ScoredMove{Move{pop_lsb(b), SQ_NONE, V_WALL}, 0};
+        for (ScoredMove* m = cur; m != end; ++m)
+            m->score = history.score(pos.side_to_move, m->move)
+                     + (m->move == counter ? COUNTER_MOVE_BONUS : 0);
+        stage_end = end;
+        [[fallthrough]];
+
+    case QUIET:
+        while (cur != end) {
+            Move m = pick_best();
+            if (m.type == PAWN || take_wall(m))
+                return m;
+        }
+        ++stage;
+        [[fallthrough]];
+
+    case DONE:
+        break;
+    }
+    return MOVE_NONE;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "movegen.h"
+
+constexpr int HISTORY_MAX = 1 << 14;
+
+// Ordering statistics learned during a search
+struct History {
+    Move killers[MAX_DEPTH][2];
+    Move counter_moves[MOVE_TYPE_NB][SQ_NB];   // reply to the previous move
+    int scores[COLOR_NB][MOVE_TYPE_NB][SQ_NB];  // pawn moves by target, walls by index
+
+    void clear();
+    // between the searches of one game: halves the scores, drops the killers
+    void age();
+    // m caused a beta cutoff after the quiet moves in tried (m excluded) failed to
+    void update(Color us, Move m, Move prev, int ply, int depth, const Move* tried, int num_tried);
+    int score(Color us, Move m) const { return scores[us][m.type][m.type == PAWN ? m.to : m.from]; }
+};
+
+struct ScoredMove {
+    Move move;
+    int score;
+};
+
+// Generates and hands out the moves of a position one at a time, in stages: the
+// hash move, pawn moves that get closer to the goal, the killers of this ply,
+// then everything else by history score with a bonus for the counter move. Walls
+// start out pseudo-legal; the ones that close a loop in the wall chains are only
+// checked against the pawns' paths right before they are returned, so a cutoff
+// skips both the remaining ordering and the remaining legality work.
+// MoveList stays the eager, fully validated generator for perft and checks.
+class MovePicker {
+public:
+    // dist: the side to move's distance field if the caller keeps one, else it is computed
+    MovePicker(const Position& pos, Move tt_move, const History& history, int ply, Move prev,
+               const uint8_t* dist = nullptr);
+
+    // MOVE_NONE once all moves have been returned
+    Move next_move();
+    // the last move came from the history-ordered tail, not from the hash/forward/killer stages
+    bool in_quiet_stage() const { return stage >= QUIET; }
+
+private:
+    enum Stage { TT_STAGE, FORWARD_INIT, FORWARD, KILLERS_INIT, KILLERS, QUIET_INIT, QUIET, DONE };
+
+    Move pick_best();
+    // Takes a wall out of the pending set, true if it is legal here
+    bool take_wall(Move m);
+    // Moves a legal hash or killer move to stage_end
+    bool hoist(Move m, int score);
+
+    const Position& pos;
+    const History& history;
+    Move tt_move;
+    Move killers[2];
+    Move counter;
+    const uint8_t* dist;
+    int stage;
+
+    // walls not yet handed out, and the ones among them still needing a path check
+    Bitboard h_walls, v_walls;
+    Bitboard h_unchecked, v_unchecked;
+
+    ScoredMove moves[256];
+    ScoredMove* cur;
+    ScoredMove* stage_end;
+    ScoredMove* end;
+};
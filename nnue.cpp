@@ -0,0 +1,249 @@
+#include "nnue.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace NnueArch;
+
+NnueNetwork Nnue;
+
+namespace {
+
+constexpr char NNUE_MAGIC[8] = {'Q', 'N', 'N', 'U', 'E', '1', 0, 0};
+
+// Square s as seen by perspective p: black looks at the board upside down.
+// A wall on s sits between ranks r and r - 1, which flip to RANK_NB - r and
+// RANK_NB - 1 - r.
+Square pawn_view(Color p, Square s) {
+    return p == WHITE ? s : make_square(Rank(RANK_LAST - rank_of(s)), file_of(s));
+}
+
+Square wall_view(Color p, Square s) {
+    return p == WHITE ? s : make_square(Rank(RANK_NB - rank_of(s)), file_of(s));
+}
+
+int wall_feature(Color p, Move m) {
+    return (m.type == H_WALL ? H_WALLS : V_WALLS) + wall_view(p, m.from);
+}
+
+// The output layer: one sum over the last hidden layer
+int32_t output_layer(const uint8_t* in, const int8_t* w) {
+#ifdef __AVX2__
+    const __m256i products = _mm256_maddubs_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(in)),
+                                                  _mm256_load_si256(reinterpret_cast<const __m256i*>(w)));
+    const __m256i sum = _mm256_madd_epi16(products, _mm256_set1_epi16(1));
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+#else
+    int32_t sum = 0;
+    for (int i = 0; i < L3; ++i)
+        sum += in[i] * w[i];
+    return sum;
+#endif
+}
+
+template<int OUT, int IN>
+void hidden_layer(const uint8_t* in, const int32_t* bias, const int8_t (*weights)[IN], uint8_t* out) {
+#ifdef __AVX2__
+    // four outputs at a time, their sums folded together at the end
+    const __m256i ones = _mm256_set1_epi16(1);
+    for (int j = 0; j < OUT; j += 4) {
+        __m256i sum[4];
+        for (int k = 0; k < 4; ++k)
+            sum[k] = _mm256_setzero_si256();
+        for (int i = 0; i < IN; i += 32) {
+            const __m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(in + i));
+            for (int k = 0; k < 4; ++k) {
+                // inputs stay under 128, so the pairwise int16 sums can't saturate
+                const __m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights[j + k] + i));
+                sum[k] = _mm256_add_epi32(sum[k], _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+            }
+        }
+        const __m256i folded = _mm256_hadd_epi32(_mm256_hadd_epi32(sum[0], sum[1]), _mm256_hadd_epi32(sum[2], sum[3]));
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(folded), _mm256_extracti128_si256(folded, 1));
+        s = _mm_srai_epi32(_mm_add_epi32(s, _mm_loadu_si128(reinterpret_cast<const __m128i*>(bias + j))), SHIFT);
+        s = _mm_min_epi32(_mm_max_epi32(s, _mm_setzero_si128()), _mm_set1_epi32(127));
+        const __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(s, s), _mm_setzero_si128());
+        const int32_t four = _mm_cvtsi128_si32(bytes);
+        std::memcpy(out + j, &four, 4);
+    }
+#else
+    for (int j = 0; j < OUT; ++j) {
+        int32_t sum = bias[j];
+        for (int i = 0; i < IN; ++i)
+            sum += in[i] * weights[j][i];
+        out[j] = uint8_t(std::clamp(sum >> SHIFT, 0, 127));
+    }
+#endif
+}
+
+}
+
+void NnueNetwork::add(int16_t* acc, int feature) const {
+    const int16_t* w = ft_weights[feature];
+#ifdef __AVX2__
+    for (int i = 0; i < L1; i += 16) {
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        *a = _mm256_add_epi16(*a, _mm256_load_si256(reinterpret_cast<const __m256i*>(w + i)));
+    }
+#else
+    for (int i = 0; i < L1; ++i)
+        acc[i] += w[i];
+#endif
+}
+
+void NnueNetwork::sub(int16_t* acc, int feature) const {
+    const int16_t* w = ft_weights[feature];
+#ifdef __AVX2__
+    for (int i = 0; i < L1; i += 16) {
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        *a = _mm256_sub_epi16(*a, _mm256_load_si256(reinterpret_cast<const __m256i*>(w + i)));
+    }
+#else
+    for (int i = 0; i < L1; ++i)
+        acc[i] -= w[i];
+#endif
+}
+
+void NnueNetwork::refresh(const Position& pos, NnueAccumulator& acc) const {
+    for (Color p : {WHITE, BLACK}) {
+        int16_t* a = acc.v[p];
+        std::copy(std::begin(ft_bias), std::end(ft_bias), a);
+        add(a, PAWN_US + pawn_view(p, pos.pawn[p]));
+        add(a, PAWN_THEM + pawn_view(p, pos.pawn[~p]));
+        add(a, WALLS_US + pos.num_walls[p]);
+        add(a, WALLS_THEM + pos.num_walls[~p]);
+        for (Bitboard b = pos.h_walls_idxs; b; )
+            add(a, H_WALLS + wall_view(p, pop_lsb(b)));
+        for (Bitboard b = pos.v_walls_idxs; b; )
+            add(a, V_WALLS + wall_view(p, pop_lsb(b)));
+    }
+}
+
+void NnueNetwork::update(NnueAccumulator& acc, const Position& pos, Move m) const {
+    const Color mover = ~pos.side_to_move;
+    for (Color p : {WHITE, BLACK}) {
+        int16_t* a = acc.v[p];
+        if (m.type == PAWN) {
+            const int base = p == mover ? PAWN_US : PAWN_THEM;
+            sub(a, base + pawn_view(p, m.from));
+            add(a, base + pawn_view(p, m.to));
+        }
+        else {
+            const int base = p == mover ? WALLS_US : WALLS_THEM;
+            sub(a, base + pos.num_walls[mover] + 1);
+            add(a, base + pos.num_walls[mover]);
+            add(a, wall_feature(p, m));
+        }
+    }
+}
+
+int NnueNetwork::evaluate(const Position& pos, const NnueAccumulator& acc, int my_dist, int opp_dist) const {
+    const Color us = pos.side_to_move;
+    const int dist[COLOR_NB] = {std::min(us == WHITE ? my_dist : opp_dist, MAX_DIST),
+                                std::min(us == WHITE ? opp_dist : my_dist, MAX_DIST)};
+
+    alignas(32) uint8_t input[2 * L1];
+    for (Color p : {us, ~us}) {
+        const int16_t* a = acc.v[p];
+        const int16_t* own = ft_weights[DIST_US + dist[p]];
+        const int16_t* other = ft_weights[DIST_THEM + dist[~p]];
+        uint8_t* out = input + (p == us ? 0 : L1);
+#ifdef __AVX2__
+        auto sum = [&](int i) {
+            auto load = [i](const int16_t* v) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(v + i)); };
+            return _mm256_add_epi16(load(a), _mm256_add_epi16(load(own), load(other)));
+        };
+        for (int i = 0; i < L1; i += 32) {
+            // packs saturates to -128..127 but interleaves the 128-bit lanes
+            const __m256i packed = _mm256_packs_epi16(sum(i), sum(i + 16));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(out + i),
+                               _mm256_max_epi8(_mm256_permute4x64_epi64(packed, 0xD8), _mm256_setzero_si256()));
+        }
+#else
+        for (int i = 0; i < L1; ++i)
+            out[i] = uint8_t(std::clamp(int16_t(a[i] + own[i] + other[i]), int16_t(0), int16_t(127)));
+#endif
+    }
+
+    alignas(32) uint8_t hidden2[L2];
+    alignas(32) uint8_t hidden3[L3];
+    hidden_layer<L2, 2 * L1>(input, l2_bias, l2_weights, hidden2);
+    hidden_layer<L3, L2>(hidden2, l3_bias, l3_weights, hidden3);
+    return (out_bias + output_layer(hidden3, out_weights)) / OUTPUT_SCALE;
+}
+
+void NnueNetwork::randomize(uint32_t seed) {
+    std::mt19937 rng(seed);
+    auto uniform = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+    for (auto& b : ft_bias) b = int16_t(uniform(0, 32));
+    for (auto& row : ft_weights)
+        for (auto& w : row) w = int16_t(uniform(-16, 16));
+    for (auto& b : l2_bias) b = uniform(-256, 256);
+    for (auto& row : l2_weights)
+        for (auto& w : row) w = int8_t(uniform(-8, 8));
+    for (auto& b : l3_bias) b = uniform(-256, 256);
+    for (auto& row : l3_weights)
+        for (auto& w : row) w = int8_t(uniform(-32, 32));
+    out_bias = 0;
+    for (auto& w : out_weights) w = int8_t(uniform(-64, 64));
+    is_loaded = true;
+}
+
+bool NnueNetwork::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    NnueHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, NNUE_MAGIC, sizeof(NNUE_MAGIC)) != 0
+        || header.inputs != INPUTS || header.l1 != L1 || header.l2 != L2 || header.l3 != L3)
+        return false;
+
+    // read into a copy, so a short file leaves the current network alone
+    auto net = std::make_unique<NnueNetwork>();
+    auto read = [&](auto& field) { file.read(reinterpret_cast<char*>(&field), sizeof(field)); };
+    read(net->ft_bias);
+    read(net->ft_weights);
+    read(net->l2_bias);
+    read(net->l2_weights);
+    read(net->l3_bias);
+    read(net->l3_weights);
+    read(net->out_bias);
+    read(net->out_weights);
+    if (!file || file.peek() != std::ifstream::traits_type::eof())
+        return false;
+
+    *this = *net;
+    is_loaded = true;
+    return true;
+}
+
+bool NnueNetwork::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    NnueHeader header{};
+    std::memcpy(header.magic, NNUE_MAGIC, sizeof(NNUE_MAGIC));
+    header.inputs = INPUTS;
+    header.l1 = L1;
+    header.l2 = L2;
+    header.l3 = L3;
+
+    auto write = [&](const auto& field) { file.write(reinterpret_cast<const char*>(&field), sizeof(field)); };
+    write(header);
+    write(ft_bias);
+    write(ft_weights);
+    write(l2_bias);
+    write(l2_weights);
+    write(l3_bias);
+    write(l3_weights);
+    write(out_bias);
+    write(out_weights);
+    return bool(file);
+}
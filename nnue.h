@@ -0,0 +1,103 @@
+#pragma once
+
+#include "position.h"
+#include <cstdint>
+#include <string>
+
+// Efficiently updatable network, the alternative to the hand-written eval();
+// search_options.nnue switches eval() over to it once a network is loaded.
+//
+// Inputs are sparse features seen from one side (the perspective): where its
+// pawn and the other pawn stand, every wall on the board, and how many walls
+// each side has left. Black's view is flipped rank-wise, so both sides see
+// themselves heading up the board. The first layer is the sum of the weight
+// columns of the active features, kept per perspective in an accumulator that
+// is updated move by move: a pawn move swaps one feature, a wall adds one and
+// moves the placer's wall count. The goal distances are features too, but they
+// change with every move, so their two columns are added at evaluation time.
+// The two accumulators (side to move first) are clipped to 0..127 and go
+// through two small int8 layers into the score.
+//
+// Weights file: a header, then the layers in the order of the members below,
+// in host byte order.
+
+namespace NnueArch {
+constexpr int PAWN_US = 0;
+constexpr int PAWN_THEM = PAWN_US + SQ_NB;
+constexpr int H_WALLS = PAWN_THEM + SQ_NB;
+constexpr int V_WALLS = H_WALLS + SQ_NB;
+constexpr int WALLS_US = V_WALLS + SQ_NB;        // one feature per count 0..WALLS_PER_PLAYER
+constexpr int WALLS_THEM = WALLS_US + WALLS_PER_PLAYER + 1;
+constexpr int DIST_US = WALLS_THEM + WALLS_PER_PLAYER + 1;        // one feature per distance, capped
+constexpr int DIST_THEM = DIST_US + 32;
+constexpr int MAX_DIST = 31;
+constexpr int INPUTS = DIST_THEM + 32;
+
+constexpr int L1 = 128;     // accumulator width per perspective
+constexpr int L2 = 32;
+constexpr int L3 = 32;
+// hidden layers are int8 weights over 0..127 inputs, scaled down by 2^SHIFT
+constexpr int SHIFT = 6;
+constexpr int OUTPUT_SCALE = 16;
+}
+
+struct NnueHeader {
+    char magic[8];      // "QNNUE1\0\0"
+    uint32_t inputs, l1, l2, l3;
+};
+
+struct alignas(32) NnueAccumulator {
+    int16_t v[COLOR_NB][NnueArch::L1];   // by perspective
+};
+
+class NnueNetwork {
+public:
+    // false (and the network left as it was) if the file is missing or has
+    // other dimensions
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+    // small random weights, for tests and as a starting point for training
+    void randomize(uint32_t seed);
+    bool loaded() const { return is_loaded; }
+
+    void refresh(const Position& pos, NnueAccumulator& acc) const;
+    // acc holds pos before m; afterwards it holds pos after m
+    void update(NnueAccumulator& acc, const Position& pos, Move m) const;
+    // from the side to move; distances are the pawns' steps to their goals
+    int evaluate(const Position& pos, const NnueAccumulator& acc, int my_dist, int opp_dist) const;
+
+private:
+    void add(int16_t* acc, int feature) const;
+    void sub(int16_t* acc, int feature) const;
+
+    alignas(32) int16_t ft_bias[NnueArch::L1];
+    alignas(32) int16_t ft_weights[NnueArch::INPUTS][NnueArch::L1];
+    alignas(32) int32_t l2_bias[NnueArch::L2];
+    alignas(32) int8_t l2_weights[NnueArch::L2][2 * NnueArch::L1];
+    alignas(32) int32_t l3_bias[NnueArch::L3];
+    alignas(32) int8_t l3_weights[NnueArch::L3][NnueArch::L2];
+    int32_t out_bias;
+    alignas(32) int8_t out_weights[NnueArch::L3];
+
+    bool is_loaded = false;
+};
+
+extern NnueNetwork Nnue;
+
+// Accumulators along the line being searched, kept in step with it like
+// DistanceFields; undo_move just steps back one.
+class NnueStack {
+public:
+    void init(const Position& pos) { size = 0; Nnue.refresh(pos, stack[0]); }
+    // pos is the position after m
+    void do_move(const Position& pos, Move m) {
+        stack[size + 1] = stack[size];
+        Nnue.update(stack[++size], pos, m);
+    }
+    void undo_move() { --size; }
+    const NnueAccumulator& top() const { return stack[size]; }
+
+private:
+    NnueAccumulator stack[MAX_DEPTH + 1];
+    int size = 0;
+};
@@ -1,54 +1,210 @@
 #include "position.h"
+#include <random>
 
+namespace Zobrist {
+    uint64_t pawn[COLOR_NB][SQ_NB];
+    uint64_t h_wall[SQ_NB];
+    uint64_t v_wall[SQ_NB];
+    uint64_t walls_left[COLOR_NB][SQ_NB];
+    uint64_t side;
+
+    void init() {
+        std::mt19937_64 rng(1070372);
+        for (Color c : {WHITE, BLACK})
+            for (Square sq = SQ_A1; sq < SQ_NB; ++sq)
+                pawn[c][sq] = rng();
+        for (Square sq = SQ_A1; sq < SQ_NB; ++sq) {
+            h_wall[sq] = rng();
+            v_wall[sq] = rng();
+        }
+        for (Color c : {WHITE, BLACK})
+            for (int n = 0; n < SQ_NB; ++n)
+                walls_left[c][n] = rng();
+        side = rng();
+    }
+}
 
 Position::Position() {
-    pawn[WHITE] = SQ_E1;
-    pawn[BLACK] = SQ_E9;
+    pawn[WHITE] = make_square(RANK_1, File(FILE_NB / 2));
+    pawn[BLACK] = make_square(RANK_LAST, File(FILE_NB / 2));
 
-    num_walls[WHITE] = 10;
-    num_walls[BLACK] = 10;
+    num_walls[WHITE] = WALLS_PER_PLAYER;
+    num_walls[BLACK] = WALLS_PER_PLAYER;
 
-    h_walls_idxs = Bitboard{0ULL, 0ULL};
-    v_walls_idxs = Bitboard{0ULL, 0ULL};
+    h_walls_idxs = Bitboard{};
+    v_walls_idxs = Bitboard{};
 
-    h_walls_full = Bitboard{0ULL, 0ULL};
-    v_walls_full = Bitboard{0ULL, 0ULL};
+    h_walls_full = Bitboard{};
+    v_walls_full = Bitboard{};
 
     side_to_move = WHITE;
+
+    chains[0] = EdgePoints;
+    num_chains = 1;
+    walls_on_board = 0;
+
+    h_walls_free = ValidWalls;
+    v_walls_free = ValidWalls;
+    h_walls_closing = Bitboard{};
+    v_walls_closing = Bitboard{};
+
+    key = compute_key();
+    wall_key = compute_wall_key();
+}
+
+uint64_t Position::compute_key() const {
+    uint64_t k = Zobrist::pawn[WHITE][pawn[WHITE]] ^ Zobrist::pawn[BLACK][pawn[BLACK]]
+               ^ Zobrist::walls_left[WHITE][num_walls[WHITE]] ^ Zobrist::walls_left[BLACK][num_walls[BLACK]]
+               ^ compute_wall_key();
+
+    if (side_to_move == BLACK)
+        k ^= Zobrist::side;
+    return k;
+}
+
+uint64_t Position::compute_wall_key() const {
+    uint64_t k = 0;
+    Bitboard b = h_walls_idxs;
+    while (b)
+        k ^= Zobrist::h_wall[pop_lsb(b)];
+    b = v_walls_idxs;
+    while (b)
+        k ^= Zobrist::v_wall[pop_lsb(b)];
+    return k;
 }
 
 // assumes move is legal
 void Position::do_move(Move move) {
-    if (move.type == PAWN)
-        pawn[side_to_move] = move.to;
+    const Color us = side_to_move;
+    key ^= Zobrist::side;
+
+    if (move.type == PAWN) {
+        pawn[us] = move.to;
+        key ^= Zobrist::pawn[us][move.from] ^ Zobrist::pawn[us][move.to];
+    }
     else if (move.type == H_WALL) {
         h_walls_idxs |= square_bb(move.from);
         h_walls_full |= square_bb(move.from) | square_bb(Square(move.from + EAST));
-        num_walls[side_to_move]--;
+        wall_key ^= Zobrist::h_wall[move.from];
+        key ^= Zobrist::h_wall[move.from] ^ Zobrist::walls_left[us][num_walls[us]];
+        num_walls[us]--;
+        key ^= Zobrist::walls_left[us][num_walls[us]];
+        place_wall(H_WALL, move.from);
     } 
     else {
         v_walls_idxs |= square_bb(move.from);
         v_walls_full |= square_bb(move.from) | square_bb(Square(move.from + SOUTH));    
-        num_walls[side_to_move]--;
+        wall_key ^= Zobrist::v_wall[move.from];
+        key ^= Zobrist::v_wall[move.from] ^ Zobrist::walls_left[us][num_walls[us]];
+        num_walls[us]--;
+        key ^= Zobrist::walls_left[us][num_walls[us]];
+        place_wall(V_WALL, move.from);
     }
-    side_to_move = ~side_to_move;
+    side_to_move = ~us;
 }
 
 
 void Position::undo_move(Move move) {
     side_to_move = ~side_to_move;
-    if (move.type == PAWN)
-        pawn[side_to_move] = move.from;
+    const Color us = side_to_move;
+    key ^= Zobrist::side;
+
+    if (move.type == PAWN) {
+        pawn[us] = move.from;
+        key ^= Zobrist::pawn[us][move.from] ^ Zobrist::pawn[us][move.to];
+    }
     else if (move.type == H_WALL) {
         h_walls_idxs ^= square_bb(move.from);
         h_walls_full ^= square_bb(move.from) | square_bb(Square(move.from + EAST));
-        num_walls[side_to_move]++;
+        wall_key ^= Zobrist::h_wall[move.from];
+        key ^= Zobrist::h_wall[move.from] ^ Zobrist::walls_left[us][num_walls[us]];
+        num_walls[us]++;
+        key ^= Zobrist::walls_left[us][num_walls[us]];
+        remove_wall();
     } 
     else {
         v_walls_idxs ^= square_bb(move.from);
         v_walls_full ^= square_bb(move.from) | square_bb(Square(move.from + SOUTH));    
-        num_walls[side_to_move]++;
+        wall_key ^= Zobrist::v_wall[move.from];
+        key ^= Zobrist::v_wall[move.from] ^ Zobrist::walls_left[us][num_walls[us]];
+        num_walls[us]++;
+        key ^= Zobrist::walls_left[us][num_walls[us]];
+        remove_wall();
+    }
+}
+
+
+// Candidate walls with two of their three corners in chain c
+static void closing_walls(Bitboard c, Bitboard& h_walls, Bitboard& v_walls) {
+    Bitboard west = shift<EAST>(c), east = shift<WEST>(c);
+    Bitboard south = shift<NORTH>(c), north = shift<SOUTH>(c);
+    h_walls |= ((west & c) | (west & east) | (c & east)) & ValidWalls;
+    v_walls |= ((south & c) | (south & north) | (c & north)) & ValidWalls;
+}
+
+// Merges the chains touching the new wall's corners and updates the free/closing sets
+void Position::place_wall(MoveType type, Square wall_sq) {
+    const Bitboard wall = square_bb(wall_sq);
+    const Bitboard along = type == H_WALL ? shift<WEST>(wall) | wall | shift<EAST>(wall)
+                                          : shift<SOUTH>(wall) | wall | shift<NORTH>(wall);
+    Bitboard corners = along;
+
+    ChainUndo& undo = chain_history[walls_on_board++];
+    undo.num_chains = 0;
+    undo.h_walls_free = h_walls_free;
+    undo.v_walls_free = v_walls_free;
+    undo.h_walls_closing = h_walls_closing;
+    undo.v_walls_closing = v_walls_closing;
+
+    int target = -1;
+    for (int i = 0; i < num_chains; ++i) {
+        if (!(chains[i] & corners))
+            continue;
+
+        undo.chain_idxs[undo.num_chains] = i;
+        undo.chains[undo.num_chains++] = chains[i];
+        if (target < 0)
+            target = i;
+        else {
+            corners |= chains[i];
+            chains[i] = Bitboard{};
+        }
     }
+
+    undo.appended = target < 0;
+    if (undo.appended) {
+        target = num_chains++;
+        chains[target] = Bitboard{};
+    }
+    chains[target] |= corners;
+
+    // walls overlapping or crossing the new one are no longer possible
+    Bitboard h_taken = type == H_WALL ? along : wall;
+    Bitboard v_taken = type == V_WALL ? along : wall;
+
+    Bitboard h_closing = h_walls_closing, v_closing = v_walls_closing;
+    closing_walls(chains[target], h_closing, v_closing);
+
+    Bitboard h_open = (h_walls_free | h_walls_closing) & ~h_taken;
+    Bitboard v_open = (v_walls_free | v_walls_closing) & ~v_taken;
+    h_walls_closing = h_open & h_closing;
+    v_walls_closing = v_open & v_closing;
+    h_walls_free = h_open & ~h_closing;
+    v_walls_free = v_open & ~v_closing;
+}
+
+void Position::remove_wall() {
+    const ChainUndo& undo = chain_history[--walls_on_board];
+
+    if (undo.appended)
+        num_chains--;
+    for (int k = 0; k < undo.num_chains; ++k)
+        chains[undo.chain_idxs[k]] = undo.chains[k];
+
+    h_walls_free = undo.h_walls_free;
+    v_walls_free = undo.v_walls_free;
+    h_walls_closing = undo.h_walls_closing;
+    v_walls_closing = undo.v_walls_closing;
 }
 
 
@@ -64,8 +220,8 @@ bool Position::is_terminal() const {
 // this makes it so that horizontal walls are between the square and the square south of it 
 // and vertical walls are the the square and the square east of it
 void Position::print_board() const { 
-    for (Rank rank = RANK_9; rank >= RANK_1; --rank) {
-        for (File file = FILE_A; file <= FILE_I; ++file) {
+    for (Rank rank = RANK_LAST; rank >= RANK_1; --rank) {
+        for (File file = FILE_A; file <= FILE_LAST; ++file) {
             Square sq = make_square(rank, file);
             if (pawn[WHITE] == sq) 
                 std::cout << "W";
@@ -74,7 +230,7 @@ void Position::print_board() const {
             else
                 std::cout << ".";
         
-            if (file < FILE_I) {
+            if (file < FILE_LAST) {
                 if (v_walls_full & sq)
                     std::cout << "|";
                 else
@@ -84,7 +240,7 @@ void Position::print_board() const {
 
         std::cout << std::endl;
 
-        for (File file = FILE_A; file <= FILE_I; ++file) {
+        for (File file = FILE_A; file <= FILE_LAST; ++file) {
             Square sq = make_square(rank, file);
             if (rank > RANK_1) {
                 if (h_walls_full & sq)
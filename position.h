@@ -4,6 +4,32 @@
 #include "bitboard.h"
 #include <iostream>
 
+namespace Zobrist {
+    extern uint64_t pawn[COLOR_NB][SQ_NB];
+    extern uint64_t h_wall[SQ_NB];
+    extern uint64_t v_wall[SQ_NB];
+    extern uint64_t walls_left[COLOR_NB][SQ_NB];
+    extern uint64_t side;
+
+    void init();
+}
+
+// walls that can ever be on the board, both players' all placed
+constexpr int MAX_WALLS = 2 * WALLS_PER_PLAYER;
+
+// What a wall placement changed in the chain tracking, so undo_move can restore it
+struct ChainUndo {
+    Bitboard chains[3];
+    uint8_t chain_idxs[3];
+    uint8_t num_chains;
+    bool appended;
+
+    Bitboard h_walls_free;
+    Bitboard v_walls_free;
+    Bitboard h_walls_closing;
+    Bitboard v_walls_closing;
+};
+
 struct Position {
     Square pawn[COLOR_NB];
     uint16_t num_walls[COLOR_NB];
@@ -16,10 +42,37 @@ struct Position {
     Bitboard h_walls_full;
     Bitboard v_walls_full;
 
+    // Zobrist key of pawns, wall indexes, wall counts and side to move
+    uint64_t key;
+    // Zobrist key of the wall indexes alone, which is all distances to goal depend on
+    uint64_t wall_key;
+
+    // Wall chains: corners joined by placed walls, chain 0 being the board edge.
+    // A new wall can only cut the board in two if it closes a loop, i.e. touches one
+    // chain at two of its three corners. Open walls that don't are always legal (free);
+    // the ones that do (closing) still need a path check against the pawns.
+    Bitboard chains[MAX_WALLS + 1];
+    uint8_t num_chains;
+
+    Bitboard h_walls_free;
+    Bitboard v_walls_free;
+    Bitboard h_walls_closing;
+    Bitboard v_walls_closing;
+
+    ChainUndo chain_history[MAX_WALLS];
+    uint8_t walls_on_board;
+
     Position();
 
     void do_move(Move move);
     void undo_move(Move move);
     bool is_terminal() const;
     void print_board() const;
+    // from scratch; call after editing pawns or wall counts by hand
+    uint64_t compute_key() const;
+    uint64_t compute_wall_key() const;
+
+private:
+    void place_wall(MoveType type, Square wall_sq);
+    void remove_wall();
 };
@@ -6,6 +6,10 @@ from enum import Enum, auto
 from typing import Iterable, Iterator, Optional, Union
 
 from collections import deque
+from pathlib import Path
+
+import ctypes
+import os
 
 BOARD_SIZE = 9  # 9x9 cells; walls are placeable on an 8x8 grid
 
@@ -151,14 +155,14 @@ def is_valid_wall_placement(s: State, mv: WallMove) -> bool:
             return False
         # Crossing if a vertical wall spans exactly across (r,c) boundary:
         # That means a vertical wall with segments at (r, c) and (r + 1, c)
-        if (r, c) in s.vertical_walls and (r + 1, c) in s.vertical_walls:
+        if _wall_starts_at(s.vertical_walls, (r, c), (1, 0)):
             return False
     else:
         # V wall at (r,c) occupies vertical segments (r,c) and (r+1,c)
         if (r, c) in s.vertical_walls or (r + 1, c) in s.vertical_walls:
             return False
         # Crossing if a horizontal wall spans across (r,c):
-        if (r, c) in s.horizontal_walls and (r, c + 1) in s.horizontal_walls:
+        if _wall_starts_at(s.horizontal_walls, (r, c), (0, 1)):
             return False
 
     # Temporarily place and ensure both players still have a path
@@ -197,6 +201,19 @@ def is_valid_wall_placement(s: State, mv: WallMove) -> bool:
     return True
 
 
+def _wall_starts_at(segments: frozenset[tuple[int, int]], cell: tuple[int, int], step: tuple[int, int]) -> bool:
+    # Walls are two segments long, so in a run of segments along step they start at
+    # every other one. Two walls meeting end to end at cell don't make one through it.
+    r, c = cell
+    dr, dc = step
+    if cell not in segments or (r + dr, c + dc) not in segments:
+        return False
+    before = 0
+    while (r - dr * (before + 1), c - dc * (before + 1)) in segments:
+        before += 1
+    return before % 2 == 0
+
+
 def place_wall_segments_inplace(hw: set[tuple[int, int]], vw: set[tuple[int, int]], mv: WallMove) -> None:
     r, c, o = mv.r, mv.c, mv.o
     if o is Orientation.H:
@@ -310,6 +327,19 @@ def distance_to_goal(s: State, p: Player) -> int:
 
 
 def legal_moves(s: State) -> list[Move]:
+    # The C++ engine when it is built and takes the position; the pure rules
+    # handle anything else (half walls, odd wall counts, overlapping walls)
+    if NATIVE is not None:
+        pos = _to_native(s)
+        if pos is not None:
+            try:
+                return _native_legal_moves((_QdPosition * 1)(pos))[0]
+            except ValueError:
+                pass
+    return legal_moves_py(s)
+
+
+def legal_moves_py(s: State) -> list[Move]:
     moves: list[Move] = []
 
     # Pawn moves
@@ -396,6 +426,170 @@ def alpha_beta(
         return value, best_move
 
 
+# ---------- Native engine (libquoridor.so, see capi.h) ----------
+#
+# `make lib` builds the library next to the Makefile; QUORIDOR_LIB points elsewhere
+# and QUORIDOR_NATIVE=0 turns it off; a library built for another board size is
+# ignored. The engine numbers squares 0..BOARD_SIZE**2 - 1 from a1, white starting
+# on e1 (our (8, 4)) and heading for rank 9 (our row 0), and names a wall by its
+# top-left cell, as WallMove does.
+
+QD_MAX_MOVES = 256
+QD_MAX_WALLS = 64
+QD_NONE = 255
+QD_PAWN, QD_H_WALL, QD_V_WALL = 0, 1, 2
+
+
+class _QdMove(ctypes.Structure):
+    _fields_ = [("from_", ctypes.c_uint8), ("to", ctypes.c_uint8), ("type", ctypes.c_uint8)]
+
+
+class _QdPosition(ctypes.Structure):
+    _fields_ = [
+        ("pawn", ctypes.c_uint8 * 2),
+        ("walls_left", ctypes.c_uint8 * 2),
+        ("side_to_move", ctypes.c_uint8),
+        ("num_walls", ctypes.c_uint8),
+        ("walls", _QdMove * QD_MAX_WALLS),
+    ]
+
+
+def _load_native() -> Optional[ctypes.CDLL]:
+    if os.environ.get("QUORIDOR_NATIVE", "1") == "0":
+        return None
+    path = os.environ.get("QUORIDOR_LIB") or str(Path(__file__).resolve().parent.parent / "libquoridor.so")
+    try:
+        lib = ctypes.CDLL(path)
+    except OSError:
+        return None
+    if lib.qd_version() != 2 or lib.qd_board_size() != BOARD_SIZE:
+        return None
+
+    pos_p = ctypes.POINTER(_QdPosition)
+    move_p = ctypes.POINTER(_QdMove)
+    int_p = ctypes.POINTER(ctypes.c_int)
+    i32_p = ctypes.POINTER(ctypes.c_int32)
+    lib.qd_set_threads.argtypes = [ctypes.c_int]
+    lib.qd_set_hash.argtypes = [ctypes.c_int]
+    lib.qd_legal_moves.argtypes = [pos_p, ctypes.c_int, move_p, int_p]
+    lib.qd_eval.argtypes = [pos_p, ctypes.c_int, i32_p]
+    lib.qd_search.argtypes = [pos_p, ctypes.c_int, ctypes.c_int, ctypes.c_int, i32_p, move_p]
+    lib.qd_init()
+    return lib
+
+
+NATIVE = _load_native()
+
+
+def _square(cell: tuple[int, int]) -> int:
+    r, c = cell
+    return (BOARD_SIZE - 1 - r) * BOARD_SIZE + c
+
+
+def _cell(sq: int) -> tuple[int, int]:
+    return BOARD_SIZE - 1 - sq // BOARD_SIZE, sq % BOARD_SIZE
+
+
+def _pair_segments(segments: frozenset[tuple[int, int]], along: int) -> Optional[list[tuple[int, int]]]:
+    # Whole walls covering the segments, pairing each run of them from its start;
+    # along is the axis the segments of one wall share (1: same row, 0: same column)
+    walls = []
+    left = set(segments)
+    for seg in sorted(segments, key=lambda rc: (rc[1 - along], rc[along])):
+        if seg not in left:
+            continue
+        nxt = (seg[0], seg[1] + 1) if along == 1 else (seg[0] + 1, seg[1])
+        if nxt not in left:
+            return None
+        left -= {seg, nxt}
+        walls.append(seg)
+    return walls
+
+
+def _to_native(s: State) -> Optional[_QdPosition]:
+    # None when the walls aren't whole walls, which only the pure rules can handle
+    h = _pair_segments(s.horizontal_walls, along=1)
+    v = _pair_segments(s.vertical_walls, along=0)
+    if h is None or v is None or len(h) + len(v) > QD_MAX_WALLS:
+        return None
+
+    pos = _QdPosition()
+    pos.pawn[0], pos.pawn[1] = _square(s.white), _square(s.black)
+    pos.walls_left[0], pos.walls_left[1] = s.white_walls, s.black_walls
+    pos.side_to_move = 0 if s.to_move is Player.WHITE else 1
+    pos.num_walls = len(h) + len(v)
+    for i, (cell, kind) in enumerate([(w, QD_H_WALL) for w in h] + [(w, QD_V_WALL) for w in v]):
+        pos.walls[i] = _QdMove(_square(cell), QD_NONE, kind)
+    return pos
+
+
+def _from_native(m: _QdMove) -> Move:
+    if m.type == QD_PAWN:
+        return PawnMove(_cell(m.to))
+    r, c = _cell(m.from_)
+    return WallMove(r, c, Orientation.H if m.type == QD_H_WALL else Orientation.V)
+
+
+_REJECTED = (
+    "position rejected by the engine: pawns off the board or on one square, more walls"
+    " in hand than a player starts with, more on the board than both together, or walls"
+    " overlapping or crossing"
+)
+
+
+def _native_batch(states: Iterable[State]) -> ctypes.Array:
+    if NATIVE is None:
+        raise RuntimeError("libquoridor.so is not available (run make lib)")
+    positions = []
+    for s in states:
+        pos = _to_native(s)
+        if pos is None:
+            raise ValueError(f"walls are not whole walls: {s}")
+        positions.append(pos)
+    return (_QdPosition * len(positions))(*positions)
+
+
+def _native_legal_moves(batch: ctypes.Array) -> list[list[Move]]:
+    n = len(batch)
+    moves = (_QdMove * (n * QD_MAX_MOVES))()
+    counts = (ctypes.c_int * n)()
+    if NATIVE.qd_legal_moves(batch, n, moves, counts):
+        raise ValueError(_REJECTED)
+    # pawn moves first, then walls in the order legal_moves_py lists them
+    result = []
+    for i in range(n):
+        found = [_from_native(moves[i * QD_MAX_MOVES + k]) for k in range(counts[i])]
+        pawns = [m for m in found if isinstance(m, PawnMove)]
+        walls = sorted((m for m in found if isinstance(m, WallMove)), key=lambda w: (w.r, w.c, w.o.value))
+        result.append(pawns + walls)
+    return result
+
+
+def legal_moves_batch(states: Iterable[State]) -> list[list[Move]]:
+    return _native_legal_moves(_native_batch(states))
+
+
+def engine_evaluate_batch(states: Iterable[State]) -> list[int]:
+    # The engine's own evaluation, from the side to move (not evaluate())
+    batch = _native_batch(states)
+    scores = (ctypes.c_int32 * len(batch))()
+    if NATIVE.qd_eval(batch, len(batch), scores):
+        raise ValueError(_REJECTED)
+    return list(scores)
+
+
+def engine_search_batch(
+    states: Iterable[State], depth: int = 4, time_ms: int = 0
+) -> list[tuple[int, Optional[Move]]]:
+    # (score from the side to move, best move) per state; None for finished games
+    batch = _native_batch(states)
+    scores = (ctypes.c_int32 * len(batch))()
+    best = (_QdMove * len(batch))()
+    if NATIVE.qd_search(batch, len(batch), depth, time_ms, scores, best):
+        raise ValueError(_REJECTED)
+    return [(scores[i], None if best[i].from_ == QD_NONE else _from_native(best[i])) for i in range(len(batch))]
+
+
 # ---------- Example usage ----------
 
 if __name__ == "__main__":
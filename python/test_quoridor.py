@@ -14,8 +14,17 @@ from quoridor import (
     is_terminal,
     evaluate,
     wall_blocks_between,
+    NATIVE,
+    legal_moves_py,
+    legal_moves_batch,
+    engine_evaluate_batch,
+    engine_search_batch,
 )
 
+import random
+
+native = pytest.mark.skipif(NATIVE is None, reason="libquoridor.so not built (make lib)")
+
 
 def targets_of_pawn_moves(moves):
     return {mv.to for mv in moves if isinstance(mv, PawnMove)}
@@ -212,3 +221,72 @@ def test_is_terminal_and_distance_and_evaluate():
     s_lost = State(black=(8, 4))
     assert is_terminal(s_won) == Player.WHITE
     assert is_terminal(s_lost) == Player.BLACK
+
+
+def test_walls_meeting_end_to_end_do_not_block_a_crossing_wall():
+    # V walls at (3,4) and (5,4) touch at the corner of (4,4); an H wall through it crosses neither
+    s = State().with_move(WallMove(3, 4, Orientation.V)).with_move(WallMove(5, 4, Orientation.V))
+    assert is_valid_wall_placement(s, WallMove(4, 4, Orientation.H))
+    assert not is_valid_wall_placement(s, WallMove(3, 4, Orientation.H))
+
+
+def random_states(seed, games, plies):
+    rng = random.Random(seed)
+    for _ in range(games):
+        s = State()
+        for _ in range(plies):
+            if is_terminal(s) is not None:
+                break
+            yield s
+            mvs = legal_moves(s)
+            pawn = only_pawn_moves(mvs)
+            s = s.with_move(rng.choice(mvs if rng.random() < 0.5 else pawn))
+
+
+@native
+def test_native_legal_moves_match_pure_rules():
+    states = list(random_states(seed=1, games=2, plies=40))
+    for s, moves in zip(states, legal_moves_batch(states)):
+        assert set(moves) == set(legal_moves_py(s))
+        assert set(legal_moves(s)) == set(moves)
+
+
+@native
+def test_native_eval_and_search():
+    s0 = State()
+    assert engine_evaluate_batch([s0, s0.with_move(PawnMove((7, 4)))])[0] > 0
+
+    (score, mv), (lost, none) = engine_search_batch([s0, State(white=(0, 3))], depth=3)
+    assert mv in legal_moves(s0)
+    # Black to move with White already home
+    assert none is None and lost < 0
+
+
+@native
+def test_native_rejects_partial_walls():
+    with pytest.raises(ValueError):
+        legal_moves_batch([State(horizontal_walls=frozenset({(6, 4)}))])
+    # legal_moves itself falls back to the pure rules
+    assert len(legal_moves(State(horizontal_walls=frozenset({(6, 4)})))) > 0
+
+
+@native
+def test_native_rejects_more_walls_than_in_play():
+    # more whole walls than both players together can place (24 on 9x9)
+    segs = set()
+    for r in range(6):
+        for c in range(0, BOARD_SIZE - 1, 2):
+            segs |= make_h_segments_at(r, c)
+    with pytest.raises(ValueError):
+        legal_moves_batch([State(horizontal_walls=frozenset(segs))])
+
+
+@native
+def test_legal_moves_falls_back_on_positions_the_engine_rejects():
+    too_many = State(white_walls=12)
+    with pytest.raises(ValueError):
+        legal_moves_batch([too_many])
+    assert legal_moves(too_many) == legal_moves_py(too_many)
+    crossing = State(horizontal_walls=frozenset(make_h_segments_at(4, 3)),
+                     vertical_walls=frozenset({(4, 3), (5, 3)}))
+    assert legal_moves(crossing) == legal_moves_py(crossing)
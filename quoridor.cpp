@@ -2,9 +2,23 @@
 #include "bitboard.h"
 #include "movegen.h"
 #include "search.h"
+#include "book.h"
+#include "engine.h"
+#include "record.h"
+#include "stats.h"
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
 
+constexpr const char* BOOK_PATH = "quoridor.book";
 
 void ai_vs_ai() {
+    if (Book.open(BOOK_PATH))
+        std::cout << "Opening book: " << Book.size() << " positions\n";
+
     Position pos;
     pos.print_board();
     while (!pos.is_terminal()) {
@@ -30,6 +44,8 @@ void ai_takeover(Position& pos) {
 }
 
 
+// the hand-placed positions below are on the 9x9 board
+#if BOARD_SIZE == 9
 void testing() {
     Position pos;
     // pos.print_board();
@@ -43,6 +59,7 @@ void testing() {
 
     pos.num_walls[WHITE] = 3;
     pos.num_walls[BLACK] = 3;
+    pos.key = pos.compute_key();
 
     pos.print_board();
 
@@ -54,12 +71,680 @@ void testing() {
     // std::cout << "Best move score: " << score << "\n";
     // best.print_move();
 }
+#endif
+
+// Times the single-pass wall legality filter against the per-candidate flood fills,
+// and full wall generation from the chain-tracked sets, on midgame positions from
+// seeded random games, and checks the filters agree.
+void bench_wall_legality() {
+    std::mt19937 rng(2024);
+    std::vector<Position> positions;
+
+    while (positions.size() < 1000) {
+        Position pos;
+        for (int ply = 0; ply < 24 && !pos.is_terminal(); ++ply) {
+            // pawn moves come first in the list; play one two times out of three
+            MoveList moves(pos);
+            size_t num_pawn = 0;
+            while (moves.moves[num_pawn].type == PAWN)
+                ++num_pawn;
+            size_t pick = rng() % 3 ? rng() % num_pawn : rng() % moves.size();
+            pos.do_move(moves.moves[pick]);
+        }
+        if (!pos.is_terminal())
+            positions.push_back(pos);
+    }
+
+    using clock = std::chrono::steady_clock;
+    for (int slow = 1; slow >= 0; --slow) {
+        int kept = 0;
+        auto start = clock::now();
+        for (int rep = 0; rep < 10; ++rep) {
+            for (const Position& pos : positions) {
+                Bitboard h_walls, v_walls;
+                pseudo_legal_walls(pos, h_walls, v_walls);
+                if (slow)
+                    remove_blocking_walls_slow(pos, h_walls, v_walls);
+                else
+                    remove_blocking_walls(pos, h_walls, v_walls);
+                kept += popcount(h_walls) + popcount(v_walls);
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        std::cout << (slow ? "flood fill per wall: " : "cut detection:       ")
+                  << ns / (10 * positions.size()) << " ns/position, " << kept << " walls kept\n";
+    }
+
+    int generated = 0;
+    auto start = clock::now();
+    for (int rep = 0; rep < 10; ++rep) {
+        for (const Position& pos : positions) {
+            Move moves[256];
+            generated += generate_wall_moves(pos, moves) - moves;
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    std::cout << "chain lookup + cuts:  " << ns / (10 * positions.size()) << " ns/position, " << generated << " walls generated\n";
+
+    for (const Position& pos : positions) {
+        Bitboard h_fast, v_fast, h_slow, v_slow;
+        pseudo_legal_walls(pos, h_fast, v_fast);
+        h_slow = h_fast;
+        v_slow = v_fast;
+        remove_blocking_walls(pos, h_fast, v_fast);
+        remove_blocking_walls_slow(pos, h_slow, v_slow);
+        if ((h_fast ^ h_slow) || (v_fast ^ v_slow)) {
+            std::cout << "Wall legality mismatch\n";
+            pos.print_board();
+        }
+    }
+}
+
+// Random do/undo walks checking the incrementally updated state in Position against
+// a from-scratch computation: the chain-tracked wall sets against pseudo-legal walls
+// with one flood fill pair per wall, and the Zobrist keys against compute_key() and compute_wall_key()
+void test_incremental_state() {
+    std::mt19937 rng(7);
+    int checked = 0;
+
+    // the incremental distance maps must match a fresh BFS after every do and undo;
+    // sometimes only the pawns are read, which leaves the deferred update pending
+    DistanceFields fields;
+    auto fields_match = [&](const Position& pos) {
+        const bool whole = rng() & 1;
+        for (Color c : {WHITE, BLACK}) {
+            uint8_t dist[SQ_NB];
+            distance_field(pos, c, dist);
+            if (fields.distance(c, pos.pawn[c]) != dist[pos.pawn[c]])
+                return false;
+            if (whole && !std::equal(dist, dist + SQ_NB, fields.field(c)))
+                return false;
+        }
+        return true;
+    };
+
+    for (int game = 0; game < 200; ++game) {
+        Position pos;
+        for (int ply = 0; ply < 80 && !pos.is_terminal(); ++ply) {
+            fields.init(pos);
+            Move line[8];
+            int depth = 0;
+            for (; depth < 8 && !pos.is_terminal(); ++depth) {
+                MoveList moves(pos);
+                line[depth] = moves.moves[rng() % moves.size()];
+                pos.do_move(line[depth]);
+                fields.do_move(pos, line[depth]);
+                if (!fields_match(pos)) {
+                    std::cout << "Distance field mismatch after a move\n";
+                    pos.print_board();
+                    return;
+                }
+
+                Bitboard h_walls, v_walls;
+                pseudo_legal_walls(pos, h_walls, v_walls);
+                remove_blocking_walls_slow(pos, h_walls, v_walls);
+                if (pos.num_walls[pos.side_to_move] == 0)
+                    h_walls = v_walls = Bitboard{};
+
+                Move walls[256];
+                Move* last = generate_wall_moves(pos, walls);
+                Bitboard h_gen = Bitboard{}, v_gen = Bitboard{};
+                for (Move* m = walls; m != last; ++m)
+                    (m->type == H_WALL ? h_gen : v_gen) |= m->from;
+
+                if ((h_gen ^ h_walls) || (v_gen ^ v_walls)) {
+                    std::cout << "Wall generation mismatch\n";
+                    pos.print_board();
+                    return;
+                }
+                // the lazy picker must hand out exactly the eager list, even given a stale hash move
+                static History history;
+                history.clear();
+                MoveList all(pos);
+                history.killers[0][0] = all.moves[rng() % all.size()];
+                MovePicker picker(pos, line[depth], history, 0, MOVE_NONE);
+                std::vector<Move> picked;
+                bool picked_ok = true;
+                for (Move m = picker.next_move(); !m.is_none(); m = picker.next_move()) {
+                    picked_ok &= all.contains(m) && std::find(picked.begin(), picked.end(), m) == picked.end();
+                    picked.push_back(m);
+                }
+                if (!picked_ok || picked.size() != all.size()) {
+                    std::cout << "Move picker mismatch\n";
+                    pos.print_board();
+                    return;
+                }
+                if (pos.key != pos.compute_key() || pos.wall_key != pos.compute_wall_key()) {
+                    std::cout << "Zobrist key mismatch\n";
+                    pos.print_board();
+                    return;
+                }
+                ++checked;
+            }
+
+            while (depth) {
+                fields.undo_move(line[--depth]);
+                pos.undo_move(line[depth]);
+                if (!fields_match(pos)) {
+                    std::cout << "Distance field mismatch after an undo\n";
+                    pos.print_board();
+                    return;
+                }
+            }
+
+            MoveList moves(pos);
+            pos.do_move(moves.moves[rng() % moves.size()]);
+        }
+    }
+    std::cout << "Incremental state consistent over " << checked << " positions\n";
+}
+
+#if BOARD_SIZE == 9
+// Lazy SMP scaling: time to reach a fixed depth and nodes/s for 1-16 threads,
+// from the opening and from a midgame position, each with a cleared table
+void bench_threads(int depth = 6) {
+    Position midgame;
+    for (Move m : {Move{SQ_E1, SQ_E2, PAWN}, Move{SQ_E9, SQ_E8, PAWN}, Move{SQ_E3, SQ_NONE, H_WALL},
+                   Move{SQ_D7, SQ_NONE, V_WALL}, Move{SQ_E2, SQ_D2, PAWN}, Move{SQ_E8, SQ_E7, PAWN}})
+        midgame.do_move(m);
+
+    for (const Position& start : {Position(), midgame}) {
+        for (int threads : {1, 2, 4, 8, 16}) {
+            Position pos = start;
+            new_game();
+            set_search_threads(threads);
+            iterative_deepening(pos, depth, 0);
+
+            const SearchStats& stats = last_search_stats();
+            std::cout << threads << " threads: depth " << depth << " in " << stats.seconds * 1000 << " ms, "
+                      << (long long)(stats.nodes / stats.seconds) << " nodes/s\n";
+        }
+    }
+    set_search_threads(1);
+}
+
+// Average depth reached at a fixed time per move, toggling PVS, aspiration and LMR
+void bench_search_features(int time_ms = 1000) {
+    std::vector<std::vector<Move>> lines = {
+        {},
+        {Move{SQ_E1, SQ_E2, PAWN}, Move{SQ_E9, SQ_E8, PAWN}, Move{SQ_E3, SQ_NONE, H_WALL},
+         Move{SQ_D7, SQ_NONE, V_WALL}, Move{SQ_E2, SQ_D2, PAWN}, Move{SQ_E8, SQ_E7, PAWN}},
+        {Move{SQ_E1, SQ_E2, PAWN}, Move{SQ_E9, SQ_E8, PAWN}, Move{SQ_E2, SQ_E3, PAWN},
+         Move{SQ_E8, SQ_E7, PAWN}, Move{SQ_D4, SQ_NONE, H_WALL}, Move{SQ_F6, SQ_NONE, H_WALL},
+         Move{SQ_E3, SQ_F3, PAWN}, Move{SQ_C6, SQ_NONE, V_WALL}},
+        {Move{SQ_E1, SQ_E2, PAWN}, Move{SQ_E9, SQ_E8, PAWN}, Move{SQ_E2, SQ_E3, PAWN},
+         Move{SQ_E8, SQ_E7, PAWN}, Move{SQ_E3, SQ_E4, PAWN}, Move{SQ_E7, SQ_E6, PAWN},
+         Move{SQ_E6, SQ_NONE, H_WALL}, Move{SQ_D4, SQ_NONE, H_WALL}},
+    };
+
+    struct Config { const char* name; SearchOptions opts; };
+    std::vector<Config> configs = {
+        {"plain alpha-beta", {false, false, false, 60}},
+        {"+pvs", {true, false, false, 60}},
+        {"+pvs +aspiration", {true, true, false, 60}},
+        {"+pvs +aspiration +lmr", {true, true, true, 60}},
+    };
+
+    SearchOptions saved = search_options;
+    for (const Config& config : configs) {
+        search_options = config.opts;
+        int total_depth = 0;
+        long long total_nodes = 0;
+        for (const auto& line : lines) {
+            Position pos;
+            for (Move m : line)
+                pos.do_move(m);
+            new_game();
+            iterative_deepening(pos, MAX_DEPTH, time_ms);
+            total_depth += last_search_stats().depth;
+            total_nodes += last_search_stats().nodes;
+        }
+        std::cout << config.name << ": average depth " << (double)total_depth / lines.size()
+                  << ", " << total_nodes / (long long)lines.size() << " nodes per position\n";
+    }
+    search_options = saved;
+}
+#endif
+
+// Bitboard-bound kernels over a fixed corpus; build with and without BITBOARD=simd to compare
+void bench_bitboard() {
+    std::mt19937 rng(99);
+    std::vector<Position> positions;
+    while (positions.size() < 1000) {
+        Position pos;
+        for (int ply = 0; ply < 30 && !pos.is_terminal(); ++ply) {
+            MoveList moves(pos);
+            pos.do_move(moves.moves[rng() % moves.size()]);
+        }
+        if (!pos.is_terminal())
+            positions.push_back(pos);
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto time = [&](const char* name, auto&& op) {
+        long long sink = 0;
+        auto start = clock::now();
+        for (int rep = 0; rep < 20; ++rep)
+            for (const Position& pos : positions)
+                sink += op(pos);
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        std::cout << name << ns / (20 * positions.size()) << " ns/position (" << sink << ")\n";
+    };
+
+#ifdef BITBOARD_SIMD
+    std::cout << "SSE bitboards, padded ranks\n";
+#else
+    std::cout << "scalar bitboards\n";
+#endif
+    time("distance field:     ", [](const Position& pos) {
+        uint8_t dist[SQ_NB];
+        distance_field(pos, WHITE, dist);
+        return int(dist[pos.pawn[WHITE]]);
+    });
+    time("reachability:       ", [](const Position& pos) {
+        const Passable passable(pos);
+        return int(reachable_any_goal(passable, pos.pawn[WHITE], GoalMask[WHITE]))
+             + int(reachable_any_goal(passable, pos.pawn[BLACK], GoalMask[BLACK]));
+    });
+    time("pawn moves:         ", [](const Position& pos) {
+        Move moves[16];
+        return int(generate_pawn_moves(pos, moves) - moves);
+    });
+    time("legal walls:        ", [](const Position& pos) {
+        Bitboard h_walls, v_walls;
+        pseudo_legal_walls(pos, h_walls, v_walls);
+        remove_blocking_walls(pos, h_walls, v_walls);
+        return popcount(h_walls) + popcount(v_walls);
+    });
+    time("do/undo every move: ", [](const Position& pos) {
+        Position p = pos;
+        MoveList moves(p);
+        for (Move m : moves) {
+            p.do_move(m);
+            p.undo_move(m);
+        }
+        return int(moves.size());
+    });
+}
+
+// A random game played until both sides are out of walls
+static Position random_race(std::mt19937& rng) {
+    while (true) {
+        Position pos;
+        while (!pos.is_terminal() && (pos.num_walls[WHITE] || pos.num_walls[BLACK])) {
+            MoveList moves(pos);
+            std::vector<Move> pick;
+            bool wall = pos.num_walls[pos.side_to_move] && rng() % 3;
+            for (Move m : moves)
+                if ((m.type != PAWN) == wall)
+                    pick.push_back(m);
+            // on small boards every wall can be shut out while walls are left
+            if (pick.empty())
+                pick.assign(moves.begin(), moves.end());
+            pos.do_move(pick[rng() % pick.size()]);
+        }
+        if (!pos.is_terminal())
+            return pos;
+    }
+}
+
+// Pawn-only minimax to a fixed depth, in the plies convention of endgame.h
+static int race_minimax(Position& pos, int depth) {
+    if (pos.is_terminal())
+        return 0;
+    if (depth == 0)
+        return RACE_OPEN;
+
+    int win = RACE_OPEN, loss = 0;
+    bool open = false;
+    MoveList moves(pos);
+    for (Move m : moves) {
+        pos.do_move(m);
+        int r = race_minimax(pos, depth - 1);
+        pos.undo_move(m);
+        if (r == RACE_OPEN)
+            open = true;
+        else if (!race_won(r))
+            win = std::min(win, r + 1);
+        else
+            loss = std::max(loss, r + 1);
+    }
+    return win != RACE_OPEN ? win : open ? RACE_OPEN : loss;
+}
 
-int main() {
+// The race solutions and the separated-pawns shortcut against a plain minimax,
+// over every result short enough for the minimax to see
+void test_races() {
+    std::mt19937 rng(13);
+    constexpr int DEPTH = 9;
+    int checked = 0, decided = 0;
+
+    for (int game = 0; game < 40; ++game) {
+        Position pos = random_race(rng);
+        RaceSolution solution(pos);
+
+        for (int walk = 0; walk < 20 && !pos.is_terminal(); ++walk) {
+            int plies = solution.probe(pos);
+            int expected = race_minimax(pos, DEPTH);
+            int separated = race_separated(pos, distance_to_goal(pos, pos.side_to_move),
+                                           distance_to_goal(pos, ~pos.side_to_move));
+            if ((plies <= DEPTH ? plies : RACE_OPEN) != expected
+                || (separated != RACE_OPEN && separated != plies)) {
+                std::cout << "Race mismatch: table " << plies << ", minimax " << expected
+                          << ", separated " << separated << "\n";
+                pos.print_board();
+                return;
+            }
+            ++checked;
+            decided += plies != RACE_OPEN;
+
+            MoveList moves(pos);
+            pos.do_move(moves.moves[rng() % moves.size()]);
+        }
+    }
+    std::cout << "Races consistent over " << checked << " positions, " << decided << " decided\n";
+}
+
+// Searches of positions without walls left, with and without the race resolver
+void bench_races(int depth = 10) {
+    std::mt19937 rng(21);
+    std::vector<Position> positions;
+    for (int i = 0; i < 20; ++i)
+        positions.push_back(random_race(rng));
+
+    SearchOptions saved = search_options;
+    for (bool races : {false, true}) {
+        search_options.races = races;
+        RaceTB.clear();
+        long long nodes = 0;
+        double seconds = 0;
+        for (Position pos : positions) {
+            new_game();
+            iterative_deepening(pos, depth, 0);
+            nodes += last_search_stats().nodes;
+            seconds += last_search_stats().seconds;
+        }
+        std::cout << (races ? "races resolved: " : "plain search:   ") << nodes << " nodes, "
+                  << seconds * 1000 << " ms\n";
+    }
+    search_options = saved;
+}
+
+// The network's accumulators after every do and undo against a full refresh, a
+// save and load round trip, and evaluation speed against the hand-written eval.
+// Runs on random weights, which it leaves loaded.
+void test_nnue() {
+    std::mt19937 rng(5);
+    Nnue.randomize(rng());
+    NnueStack stack;
+    NnueAccumulator fresh;
+    auto matches = [&](const Position& pos) {
+        Nnue.refresh(pos, fresh);
+        return std::memcmp(&fresh, &stack.top(), sizeof(fresh)) == 0;
+    };
+
+    std::vector<Position> positions;
+    int checked = 0;
+    for (int game = 0; game < 200; ++game) {
+        Position pos;
+        for (int ply = 0; ply < 80 && !pos.is_terminal(); ++ply) {
+            stack.init(pos);
+            Move line[8];
+            int depth = 0;
+            for (; depth < 8 && !pos.is_terminal(); ++depth) {
+                MoveList moves(pos);
+                line[depth] = moves.moves[rng() % moves.size()];
+                pos.do_move(line[depth]);
+                stack.do_move(pos, line[depth]);
+                if (!matches(pos)) {
+                    std::cout << "Accumulator mismatch after a move\n";
+                    pos.print_board();
+                    return;
+                }
+                ++checked;
+            }
+            while (depth) {
+                stack.undo_move();
+                pos.undo_move(line[--depth]);
+                if (!matches(pos)) {
+                    std::cout << "Accumulator mismatch after an undo\n";
+                    pos.print_board();
+                    return;
+                }
+            }
+            positions.push_back(pos);
+            MoveList moves(pos);
+            pos.do_move(moves.moves[rng() % moves.size()]);
+        }
+    }
+    std::cout << "Accumulators consistent over " << checked << " positions\n";
+
+    const std::string path = "/tmp/quoridor_test.nnue";
+    std::vector<int> before;
+    for (const Position& pos : positions) {
+        Nnue.refresh(pos, fresh);
+        before.push_back(Nnue.evaluate(pos, fresh, 10, 10));
+    }
+    auto saved = std::make_unique<NnueNetwork>(Nnue);
+    Nnue.randomize(rng());
+    if (!saved->save(path) || !Nnue.load(path)) {
+        std::cout << "Cannot save and load " << path << "\n";
+        return;
+    }
+    for (size_t i = 0; i < positions.size(); ++i) {
+        Nnue.refresh(positions[i], fresh);
+        if (Nnue.evaluate(positions[i], fresh, 10, 10) != before[i]) {
+            std::cout << "Scores changed over a save and load\n";
+            return;
+        }
+    }
+    std::cout << "Network saved and loaded, " << positions.size() << " scores unchanged\n";
+
+    using clock = std::chrono::steady_clock;
+    long long sum = 0;
+    SearchOptions options = search_options;
+    for (bool nnue : {false, true}) {
+        search_options.nnue = nnue;
+        auto start = clock::now();
+        for (int round = 0; round < 20; ++round)
+            for (const Position& pos : positions)
+                sum += eval(pos);
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count()
+                    / (20.0 * positions.size());
+        std::cout << (nnue ? "network eval (refresh): " : "hand-written eval:      ") << ns << " ns\n";
+    }
+    search_options = options;
+
+    // what the search pays per node: one update and one evaluation, over few
+    // enough positions to stay in cache like a search does
+    positions.resize(256);
+    std::vector<NnueAccumulator> accumulators(positions.size());
+    std::vector<Position> children;
+    std::vector<Move> moves;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        Nnue.refresh(positions[i], accumulators[i]);
+        moves.push_back(MoveList(positions[i]).moves[0]);
+        children.push_back(positions[i]);
+        children.back().do_move(moves.back());
+    }
+    auto start = clock::now();
+    for (int round = 0; round < 1000; ++round)
+        for (size_t i = 0; i < positions.size(); ++i) {
+            NnueAccumulator acc = accumulators[i];
+            Nnue.update(acc, children[i], moves[i]);
+            sum += Nnue.evaluate(children[i], acc, 10, 10);
+        }
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count()
+                / (1000.0 * positions.size());
+    std::cout << "network update + eval:  " << ns << " ns (" << sum % 2 << ")\n";
+}
+
+// Packing round trips over random positions, then a few self-play games written
+// out and read back through the mapping
+void test_records() {
+    std::mt19937 rng(9);
+    int checked = 0;
+    for (int game = 0; game < 200; ++game) {
+        Position pos;
+        for (int ply = 0; ply < 80 && !pos.is_terminal(); ++ply) {
+            const PositionRecord r = pack(pos);
+            Position back;
+            const bool unpacked = unpack(r, back);
+            const PositionRecord again = pack(back);
+            if (!unpacked || back.key != pos.key || back.wall_key != pos.wall_key
+                || MoveList(back).size() != MoveList(pos).size()
+                || std::memcmp(&r, &again, sizeof(r)) != 0) {
+                std::cout << "Record round trip mismatch\n";
+                pos.print_board();
+                return;
+            }
+            ++checked;
+            MoveList moves(pos);
+            pos.do_move(moves.moves[rng() % moves.size()]);
+        }
+    }
+    std::cout << "Records round trip over " << checked << " positions\n";
+
+    // damaged records: every wall, two overlapping walls, both pawns on one square
+    PositionRecord bad = pack(Position());
+    bad.h_walls = ~0ULL;
+    Position back;
+    bool rejected = !unpack(bad, back);
+    bad.h_walls = 0b11;
+    rejected &= !unpack(bad, back);
+    bad = pack(Position());
+    bad.pawn[BLACK] = bad.pawn[WHITE];
+    rejected &= !unpack(bad, back);
+    if (!rejected) {
+        std::cout << "Damaged record accepted\n";
+        return;
+    }
+
+    const std::string path = "/tmp/quoridor_test.pos";
+    std::remove(path.c_str());
+    const size_t written = generate_records(path, 4, 2) + generate_records(path, 2, 2, 2);
+    RecordFile file;
+    if (!file.open(path) || file.size() != written) {
+        std::cout << "Could not read back " << written << " records\n";
+        return;
+    }
+    size_t scanned = 0, decided = 0;
+    file.scan([&](const PositionRecord* r, size_t n) {
+        Position pos;
+        for (size_t i = 0; i < n; ++i, ++scanned)
+            decided += r[i].result != 0 && unpack(r[i], pos) && MoveList(pos).contains(r[i].move());
+    }, 7);
+    std::cout << "Read back " << scanned << " records, " << decided << " from decided games\n";
+}
+
+// Self-play with MCTS, one and two plies between searches so the tree is reused,
+// then again in a 1 MB arena that fills up and starts over
+void test_mcts() {
+    SearchLimits limits;
+    limits.nodes = 3000;
+    // the opponent's reply on two-ply turns: a step down its shortest path
+    auto step = [](Position& pos) {
+        const int dist = distance_to_goal(pos, pos.side_to_move);
+        for (Move m : MoveList(pos)) {
+            if (m.type != PAWN)
+                continue;
+            pos.do_move(m);
+            const bool closer = distance_to_goal(pos, ~pos.side_to_move) < dist;
+            pos.undo_move(m);
+            if (closer)
+                return m;
+        }
+        return MOVE_NONE;
+    };
+
+    int checked = 0, reused = 0;
+    for (size_t size_mb : {64, 1}) {
+        Mcts.resize(size_mb);
+        for (int game = 0; game < 4; ++game) {
+            Position pos;
+            for (int turn = 0; turn < 40 && !pos.is_terminal(); ++turn) {
+                Move best;
+                Mcts.search(pos, limits, 1, best);
+                const Position* root = Mcts.root_position();
+                if (!MoveList(pos).contains(best) || !root || root->key != pos.key
+                    || (turn && size_mb > 1 && !Mcts.stats().reused)) {
+                    std::cout << "MCTS " << size_mb << " MB: bad move " << move_to_string(best)
+                              << " or root after turn " << turn << "\n";
+                    pos.print_board();
+                    return;
+                }
+                ++checked;
+                reused += Mcts.stats().reused != 0;
+
+                // the next search is one ply on after even turns, two after odd ones
+                pos.do_move(best);
+                if (turn % 2 && !pos.is_terminal()) {
+                    const Move reply = step(pos);
+                    if (reply != MOVE_NONE)
+                        pos.do_move(reply);
+                }
+            }
+        }
+        limits.nodes = 20000;
+    }
+    Mcts.resize(64);
+    std::cout << "MCTS searches legal over " << checked << " positions, " << reused << " from a reused tree\n";
+}
+
+// A fixed-depth search from the opening and from a midgame position with the
+// instrumentation counters, written as JSON; needs make STATS=1 to count anything
+void profile_search(const std::string& path = "search_stats.json", int depth = 7) {
+    SearchOptions saved = search_options;
+    search_options.book = false;
+    search_options.verbose = false;
+
+    std::mt19937 rng(3);
+    Position midgame;
+    for (int ply = 0; ply < 20 && !midgame.is_terminal(); ++ply) {
+        Move m;
+        new_game();
+        iterative_deepening(midgame, 2, 0, m);
+        // a random move now and then, so the position is not the engine's own line
+        MoveList moves(midgame);
+        midgame.do_move(rng() % 4 ? m : moves.moves[rng() % moves.size()]);
+    }
+
+    stats_reset();
+    for (Position pos : {Position(), midgame}) {
+        new_game();
+        iterative_deepening(pos, depth, 0);
+    }
+    search_options = saved;
+
+    const Stats stats = stats_collect();
+    std::cout << stats.to_json();
+    if (!stats_write_json(path))
+        std::cout << "Could not write " << path << "\n";
+}
+
+int main(int argc, char** argv) {
     init();
 
+    // ./quoridor engine: serve the text protocol in engine.h
+    if (argc > 1 && std::string(argv[1]) == "engine") {
+        engine_loop();
+        return 0;
+    }
+
     ai_vs_ai();
     // testing();
+    // bench_wall_legality();
+    // test_incremental_state();
+    // bench_threads();
+    // bench_search_features();
+    // bench_bitboard();
+    // test_races();
+    // bench_races();
+    // test_nnue();
+    // test_records();
+    // test_mcts();
+    // profile_search();
+    // build_book(BOOK_PATH, 4, 6);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "record.h"
+#include "search.h"
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char RECORD_MAGIC[8] = {'Q', 'P', 'O', 'S', '1', 0, 0, 0};
+
+uint64_t pack_walls(Bitboard walls) {
+    uint64_t bits = 0;
+    while (walls) {
+        const Square s = pop_lsb(walls);
+        bits |= 1ULL << ((rank_of(s) - 1) * FILE_LAST + file_of(s));
+    }
+    return bits;
+}
+
+bool valid_header(const RecordHeader& header) {
+    return std::memcmp(header.magic, RECORD_MAGIC, sizeof(RECORD_MAGIC)) == 0
+        && header.record_size == sizeof(PositionRecord)
+        && (header.board_size == BOARD_SIZE || (header.board_size == 0 && BOARD_SIZE == 9));
+}
+
+}
+
+PositionRecord pack(const Position& pos) {
+    PositionRecord r{};
+    r.h_walls = pack_walls(pos.h_walls_idxs);
+    r.v_walls = pack_walls(pos.v_walls_idxs);
+    for (Color c : {WHITE, BLACK}) {
+        r.pawn[c] = uint8_t(pos.pawn[c]);
+        r.walls_left[c] = uint8_t(pos.num_walls[c]);
+    }
+    r.side_to_move = uint8_t(pos.side_to_move);
+    r.from = r.to = uint8_t(SQ_NONE);
+    return r;
+}
+
+bool unpack(const PositionRecord& r, Position& pos) {
+    if (r.pawn[WHITE] >= SQ_NB || r.pawn[BLACK] >= SQ_NB || r.pawn[WHITE] == r.pawn[BLACK]
+        || r.walls_left[WHITE] > WALLS_PER_PLAYER || r.walls_left[BLACK] > WALLS_PER_PLAYER
+        || r.side_to_move > BLACK || __builtin_popcountll(r.h_walls) + __builtin_popcountll(r.v_walls) > MAX_WALLS)
+        return false;
+
+    pos = Position();
+    for (MoveType type : {H_WALL, V_WALL})
+        for (uint64_t bits = type == H_WALL ? r.h_walls : r.v_walls; bits; bits &= bits - 1) {
+            const int i = __builtin_ctzll(bits);
+            const Square s = make_square(Rank(i / FILE_LAST + 1), File(i % FILE_LAST));
+            if (s >= SQ_NB)
+                return false;
+
+            Bitboard h_walls, v_walls;
+            pseudo_legal_walls(pos, h_walls, v_walls);
+            if (!bit_at(type == H_WALL ? h_walls : v_walls, s))
+                return false;
+            pos.do_move(Move{s, SQ_NONE, type});
+        }
+
+    for (Color c : {WHITE, BLACK}) {
+        pos.pawn[c] = Square(r.pawn[c]);
+        pos.num_walls[c] = r.walls_left[c];
+    }
+    pos.side_to_move = Color(r.side_to_move);
+    pos.key = pos.compute_key();
+    return true;
+}
+
+bool RecordWriter::open(const std::string& path) {
+    close();
+    ok = true;
+    count = 0;
+
+    // an existing file must be a record file, cut back to whole records
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && st.st_size > 0) {
+        RecordHeader header;
+        std::FILE* in = std::fopen(path.c_str(), "rb");
+        const bool valid = in && std::fread(&header, sizeof(header), 1, in) == 1 && valid_header(header);
+        if (in)
+            std::fclose(in);
+        if (!valid)
+            return false;
+        const off_t whole = sizeof(RecordHeader)
+                          + (st.st_size - off_t(sizeof(RecordHeader))) / off_t(sizeof(PositionRecord)) * off_t(sizeof(PositionRecord));
+        if (whole != st.st_size && truncate(path.c_str(), whole) != 0)
+            return false;
+        file = std::fopen(path.c_str(), "ab");
+        return file != nullptr;
+    }
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    RecordHeader header{};
+    std::memcpy(header.magic, RECORD_MAGIC, sizeof(RECORD_MAGIC));
+    header.record_size = sizeof(PositionRecord);
+    header.board_size = BOARD_SIZE;
+    ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    buffer.reserve(BUFFER_RECORDS);
+    return ok;
+}
+
+bool RecordWriter::flush() {
+    if (file && !buffer.empty()) {
+        ok &= std::fwrite(buffer.data(), sizeof(PositionRecord), buffer.size(), file) == buffer.size();
+        ok &= std::fflush(file) == 0;
+        count += buffer.size();
+    }
+    buffer.clear();
+    return ok;
+}
+
+bool RecordWriter::close() {
+    if (!file)
+        return ok;
+    flush();
+    ok &= std::fclose(file) == 0;
+    file = nullptr;
+    return ok;
+}
+
+bool RecordFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(RecordHeader))
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    if (!valid_header(*static_cast<const RecordHeader*>(map))) {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    mapping = map;
+    mapping_size = st.st_size;
+    records = reinterpret_cast<const PositionRecord*>(static_cast<const char*>(map) + sizeof(RecordHeader));
+    count = (mapping_size - sizeof(RecordHeader)) / sizeof(PositionRecord);
+    return true;
+}
+
+void RecordFile::close() {
+    if (mapping)
+        munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+    records = nullptr;
+    count = 0;
+}
+
+void RecordFile::advise(size_t first, size_t n, bool will_need) const {
+    if (n == 0)
+        return;
+    // madvise works on whole pages; dropping only the pages wholly inside the
+    // range keeps the ones shared with the next chunk
+    const size_t page = size_t(sysconf(_SC_PAGESIZE));
+    size_t begin = sizeof(RecordHeader) + first * sizeof(PositionRecord);
+    size_t end = begin + n * sizeof(PositionRecord);
+    if (will_need)
+        begin = begin / page * page;
+    else {
+        begin = (begin + page - 1) / page * page;
+        end = end / page * page;
+    }
+    if (begin < end)
+        madvise(static_cast<char*>(mapping) + begin, end - begin, will_need ? MADV_WILLNEED : MADV_DONTNEED);
+}
+
+size_t generate_records(const std::string& path, int games, int depth, uint32_t seed) {
+    constexpr int OPENING_PLIES = 8;
+    constexpr int MAX_PLIES = 300;
+
+    RecordWriter writer;
+    if (!writer.open(path)) {
+        std::cout << "Could not open records " << path << "\n";
+        return 0;
+    }
+
+    SearchOptions saved = search_options;
+    search_options.book = false;
+    search_options.verbose = false;
+    std::mt19937 rng(seed);
+    std::vector<PositionRecord> game;
+
+    for (int g = 0; g < games; ++g) {
+        // random pawn moves with the odd wall, so games spread out
+        Position pos;
+        int ply = 0;
+        for (; ply < OPENING_PLIES && !pos.is_terminal(); ++ply) {
+            MoveList moves(pos);
+            Move m = moves.moves[rng() % moves.size()];
+            while (m.type != PAWN && rng() % 4)
+                m = moves.moves[rng() % moves.size()];
+            pos.do_move(m);
+        }
+
+        new_game();
+        game.clear();
+        for (; ply < MAX_PLIES && !pos.is_terminal(); ++ply) {
+            Move best = MOVE_NONE;
+            PositionRecord r = pack(pos);
+            r.score = iterative_deepening(pos, depth, 0, best);
+            r.ply = uint16_t(ply);
+            r.from = uint8_t(best.from);
+            r.to = uint8_t(best.to);
+            r.type = uint8_t(best.type);
+            r.depth = uint8_t(last_search_stats().depth);
+            game.push_back(r);
+            pos.do_move(best);
+        }
+
+        // the side to move at the end has just lost; unfinished games are draws
+        for (PositionRecord& r : game) {
+            r.result = pos.is_terminal() ? (r.side_to_move == pos.side_to_move ? -1 : 1) : 0;
+            writer.write(r);
+        }
+    }
+    search_options = saved;
+
+    if (!writer.close()) {
+        std::cout << "Could not write records " << path << "\n";
+        return 0;
+    }
+    std::cout << "Records " << path << ": " << writer.written() << " positions from "
+              << games << " games, depth " << depth << "\n";
+    return writer.written();
+}
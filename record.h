@@ -0,0 +1,118 @@
+#pragma once
+
+#include "position.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Position records for tuning and training: a header, then fixed-size records
+// in host byte order, as many as the file holds. A file cut short by a crash
+// only loses its last partial record, and later runs append to it.
+//
+// Walls never sit on rank 1 or the last file, so each wall set packs into
+// 64 bits: a wall on s is bit (rank_of(s) - 1) * FILE_LAST + file_of(s).
+struct RecordHeader {
+    char magic[8];      // "QPOS1\0\0\0"
+    uint32_t record_size;
+    uint32_t board_size;    // 0 in files from before board sizes, which are all 9x9
+};
+
+struct PositionRecord {
+    uint64_t h_walls;
+    uint64_t v_walls;
+    int32_t score;      // search score from the side to move
+    uint8_t pawn[COLOR_NB];
+    uint8_t walls_left[COLOR_NB];
+    uint8_t side_to_move;
+    int8_t result;      // from the side to move: 1 won, 0 drawn, -1 lost
+    uint16_t ply;       // of the game
+    uint8_t from;       // the move the search chose
+    uint8_t to;
+    uint8_t type;
+    uint8_t depth;      // of that search
+
+    Move move() const { return Move{Square(from), Square(to), MoveType(type)}; }
+};
+
+static_assert(sizeof(PositionRecord) == 32, "records are written as raw bytes");
+
+// Everything but the search fields, which are left zero
+PositionRecord pack(const Position& pos);
+// The position back, walls replayed onto an empty board. False for records that
+// can't be a position (pawns off the board or on one square, more walls than
+// the game has, walls off the grid, overlapping or crossing), as files may be
+// damaged or come from elsewhere.
+bool unpack(const PositionRecord& record, Position& pos);
+
+// Appends records through a buffer of its own, a write call per buffer
+class RecordWriter {
+public:
+    RecordWriter() = default;
+    ~RecordWriter() { close(); }
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    // Appends to an existing record file, else starts a new one; false if the
+    // file can't be written or is something else
+    bool open(const std::string& path);
+    void write(const PositionRecord& record) {
+        buffer.push_back(record);
+        if (buffer.size() == BUFFER_RECORDS)
+            flush();
+    }
+    bool flush();
+    bool close();
+    size_t written() const { return count; }
+
+private:
+    static constexpr size_t BUFFER_RECORDS = 1 << 15;
+    std::FILE* file = nullptr;
+    std::vector<PositionRecord> buffer;
+    size_t count = 0;
+    bool ok = true;
+};
+
+// Read-only view of a record file mapped into memory, like OpeningBook
+class RecordFile {
+public:
+    RecordFile() = default;
+    ~RecordFile() { close(); }
+    RecordFile(const RecordFile&) = delete;
+    RecordFile& operator=(const RecordFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    size_t size() const { return count; }
+    const PositionRecord& operator[](size_t i) const { return records[i]; }
+
+    // Calls f(first, n) on consecutive chunks of up to chunk_records records,
+    // from record begin up to end. Pages are read ahead one chunk early and
+    // dropped once scanned, so files larger than memory stream through it.
+    template<typename F>
+    void scan(F&& f, size_t chunk_records = 1 << 16, size_t begin = 0, size_t end = SIZE_MAX) const {
+        end = std::min(end, count);
+        for (size_t i = begin; i < end; i += chunk_records) {
+            const size_t n = std::min(chunk_records, end - i);
+            advise(i + n, std::min(chunk_records, end - i - n), true);
+            f(records + i, n);
+            advise(i, n, false);
+        }
+    }
+
+private:
+    // tells the kernel a range of records will be needed soon, or not again
+    void advise(size_t first, size_t n, bool will_need) const;
+
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    const PositionRecord* records = nullptr;
+    size_t count = 0;
+};
+
+// Plays games of the engine against itself at the given depth from random
+// openings and appends every position with its score, move and the game's
+// result. Returns the number of positions written.
+size_t generate_records(const std::string& path, int games, int depth, uint32_t seed = 1);
@@ -1,44 +1,203 @@
 #include "search.h"
+#include "book.h"
+#include "stats.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+SearchOptions search_options;
+EvalWeights eval_weights;
+
+namespace {
+int num_threads = 1;
+SearchStats last_stats;
+// one per thread, kept between searches
+std::vector<std::unique_ptr<SearchData>> thread_data;
+}
+
+void set_search_threads(int threads) { num_threads = std::max(1, threads); }
+int search_threads() { return num_threads; }
+const SearchStats& last_search_stats() { return last_stats; }
+
+void SearchData::clear() {
+    history.clear();
+    std::fill(std::begin(cutoffs), std::end(cutoffs), 0);
+    std::fill(std::begin(first_move_cutoffs), std::end(first_move_cutoffs), 0);
+}
+
+void SearchData::new_search() {
+    history.age();
+    std::fill(std::begin(cutoffs), std::end(cutoffs), 0);
+    std::fill(std::begin(first_move_cutoffs), std::end(first_move_cutoffs), 0);
+    nodes_searched = 0;
+    completed_depth = 0;
+    time = nullptr;
+    limits = nullptr;
+    check_interval = check_countdown = 256;
+    race.reset();
+}
+
+void new_game() {
+    TT.clear();
+    Mcts.clear();
+    for (auto& sd : thread_data)
+        sd->clear();
+}
+
+void SearchData::print_cutoff_stats() const {
+    for (int d = 1; d <= MAX_DEPTH; ++d) {
+        if (!cutoffs[d])
+            continue;
+        std::cout << "  depth " << d << ": " << cutoffs[d] << " cutoffs, "
+                  << 100.0 * first_move_cutoffs[d] / cutoffs[d] << "% on the first move\n";
+    }
+}
+
+// Plies to the end of a race (see endgame.h): the solution when the root is a race
+// too and so has the same walls, otherwise the distances alone when the pawns can't
+// meet. Solving every wall set that runs out of walls below the root costs far more
+// than searching those races, and so does the distance check right above the leaves.
+static int resolve_race(const Position& pos, int depth, SearchData& sd) {
+    if (sd.race && sd.race->wall_key == pos.wall_key)
+        return sd.race->probe(pos);
+    if (depth < 2)
+        return RACE_OPEN;
+
+    const Color us = pos.side_to_move;
+    return race_separated(pos, sd.fields.field(us)[pos.pawn[us]],
+                          sd.fields.field(~us)[pos.pawn[~us]]);
+}
+
+// Main thread: node limit or hard deadline reached? Never before the first
+// iteration is done, so there is always a move to play.
+static bool out_of_budget(SearchData& sd) {
+    sd.check_countdown = sd.check_interval;
+    if (sd.completed_depth == 0)
+        return false;
+
+    const SearchLimits& limits = *sd.limits;
+    if (limits.abort && limits.abort->load(std::memory_order_relaxed))
+        return true;
+    if (limits.nodes) {
+        if (sd.nodes_searched >= limits.nodes)
+            return true;
+        sd.check_countdown = int(std::min<long long>(sd.check_countdown, limits.nodes - sd.nodes_searched));
+    }
+    if (sd.end_time == std::chrono::steady_clock::time_point::max())
+        return false;
+
+    const auto now = std::chrono::steady_clock::now();
+    const double since = std::chrono::duration<double, std::milli>(now - sd.last_check).count();
+    sd.last_check = now;
+    if (since < 0.5 && sd.check_interval < 16384)
+        sd.check_interval *= 2;
+    else if (since > 2 && sd.check_interval > 16)
+        sd.check_interval /= 2;
+    return now >= sd.end_time;
+}
 
 // Combined function: Handles both root behavior (tracking best_move) and recursive behavior
-int negamax(Position& pos, int depth, int alpha, int beta, int& nodes_searched, 
-            Move* best_move, std::chrono::steady_clock::time_point end_time, bool& time_up) {
+// prev is the move that led here, for counter-move ordering
+int negamax(Position& pos, int depth, int ply, int alpha, int beta, Move prev,
+            SearchData& sd, Move* best_move) {
     
-    ++nodes_searched;
-
-    // Check time every 2048 nodes to avoid system call overhead
-    if ((nodes_searched & 2047) == 0) {
-        if (end_time < std::chrono::steady_clock::time_point::max() && 
-            std::chrono::steady_clock::now() >= end_time) {
-            time_up = true;
-            return 0; // Return dummy value
-        }
+    ++sd.nodes_searched;
+    STATS_INC(nodes_by_ply[ply]);
+
+    if (sd.stop->load(std::memory_order_relaxed))
+        return 0; // Return dummy value
+
+    if (sd.is_main && --sd.check_countdown <= 0 && out_of_budget(sd)) {
+        sd.stop->store(true, std::memory_order_relaxed);
+        return 0; // Return dummy value
     }
 
-    if (depth == 0 || pos.is_terminal()) {
-        int score = eval(pos);
+    const bool terminal = pos.is_terminal();
+
+    // Out of walls on both sides: the race is often decided already, and then
+    // there is nothing left to search (the root still has to pick its move)
+    if (!terminal && best_move == nullptr && search_options.races
+        && pos.num_walls[WHITE] == 0 && pos.num_walls[BLACK] == 0) {
+        int plies = resolve_race(pos, depth, sd);
+        if (plies != RACE_OPEN)
+            return race_won(plies) ? WIN_SCORE + depth - plies : LOSS_SCORE - depth + plies;
+    }
+
+    if (depth == 0 || terminal) {
+        int score;
+        {
+            STATS_TIMER(eval_ns);
+            score = eval(pos, sd);
+        }
         if (score == WIN_SCORE) return WIN_SCORE + depth;
         if (score == LOSS_SCORE) return LOSS_SCORE - depth;
         return score;
     }
 
+    // Transposition table: cut off on a deep enough entry (never at the root, which
+    // has to produce a move) and otherwise search the stored best move first
+    const int alpha_orig = alpha;
+    TTData tt_data{};
+    const bool tt_hit = TT.probe(pos.key, tt_data);
+    if (tt_hit && best_move == nullptr && tt_data.depth >= depth) {
+        int tt_score = score_from_tt(tt_data.score, depth);
+        if (tt_data.bound == BOUND_EXACT
+            || (tt_data.bound == BOUND_LOWER && tt_score >= beta)
+            || (tt_data.bound == BOUND_UPPER && tt_score <= alpha)) {
+            TT.count_cutoff();
+            return tt_score;
+        }
+    }
+
     int best_val = -INF;
-    MoveList moves(pos);
+    Move best = MOVE_NONE;
+    MovePicker picker(pos, tt_hit ? tt_data.move : MOVE_NONE, sd.history, ply, prev,
+                      sd.fields.field(pos.side_to_move));
+
+    Move tried[64];
+    int num_tried = 0;
+    int move_count = 0;
+
+    const SearchOptions& opts = search_options;
 
-    // add move ordering heuristics here later
-    for (const Move& m : moves) {
+    for (Move m = picker.next_move(); !m.is_none(); m = picker.next_move()) {
+        ++move_count;
         pos.do_move(m);
+        sd.fields.do_move(pos, m);
+        if (sd.use_nnue)
+            sd.nnue.do_move(pos, m);
         // Pass nullptr for inner nodes so we don't track moves for them
         // dont care about the best move except at root
         // only thing we care about is the score for recursive calls
-        int score = -negamax(pos, depth - 1, -beta, -alpha, nodes_searched, nullptr, end_time, time_up);
+        int score;
+        if (move_count == 1 || !opts.pvs)
+            score = -negamax(pos, depth - 1, ply + 1, -beta, -alpha, m, sd, nullptr);
+        else {
+            // Late walls from the history-ordered stage are searched shallower first
+            int reduction = 0;
+            if (opts.lmr && best_move == nullptr && depth >= 3 && m.type != PAWN
+                && move_count > 3 && picker.in_quiet_stage())
+                reduction = (depth >= 5 && move_count > 12) ? 2 : 1;
+
+            // PVS: prove the move is no better than alpha with a null window,
+            // then re-search at full depth / full window when it is
+            score = -negamax(pos, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha, m, sd, nullptr);
+            if (reduction && score > alpha)
+                score = -negamax(pos, depth - 1, ply + 1, -alpha - 1, -alpha, m, sd, nullptr);
+            if (score > alpha && score < beta)
+                score = -negamax(pos, depth - 1, ply + 1, -beta, -alpha, m, sd, nullptr);
+        }
+        if (sd.use_nnue)
+            sd.nnue.undo_move();
+        sd.fields.undo_move(m);
         pos.undo_move(m);
 
-        if (time_up) return 0;
+        if (sd.stop->load(std::memory_order_relaxed)) return 0;
 
         if (score > best_val) {
             best_val = score;
-            
+            best = m;
+
             // Only update best_move if this is the root
             // Move var is passed from iterative_deepening
             if (best_move != nullptr) {
@@ -47,85 +206,249 @@ int negamax(Position& pos, int depth, int alpha, int beta, int& nodes_searched,
         }
 
         alpha = std::max(alpha, score);
-        if (alpha >= beta) break;
+        if (alpha >= beta) {
+            sd.cutoffs[depth]++;
+            STATS_INC(cutoffs_by_move[std::min(move_count, Stats::MOVE_INDEXES) - 1]);
+            sd.first_move_cutoffs[depth] += move_count == 1;
+            sd.history.update(pos.side_to_move, m, prev, ply, depth, tried, num_tried);
+            break;
+        }
+
+        if (num_tried < 64)
+            tried[num_tried++] = m;
     }
+
+    Bound bound = best_val >= beta ? BOUND_LOWER : best_val > alpha_orig ? BOUND_EXACT : BOUND_UPPER;
+    TT.store(pos.key, best, score_to_tt(best_val, depth), depth, bound);
     return best_val;
 }
 
-int iterative_deepening(Position& pos, int max_depth, int time_limit_ms, Move& best_move) {
-    using clock = std::chrono::steady_clock;
-    auto start = clock::now();
-    auto end_time = time_limit_ms > 0
-        ? start + std::chrono::milliseconds(time_limit_ms)
-        : clock::time_point::max();
-
-    int best_score = eval(pos);
-    bool time_up = false;
-    int nodes_searched = 0;
+// Deepening loop of one thread. Helpers start one ply deeper every other thread,
+// so at any time the threads are spread over two depths and fill the shared
+// table for each other.
+static int search_loop(Position& pos, int max_depth, SearchData& sd, int thread_id, Move& best_move) {
+    STATS_TIMER(search_ns);
+    sd.fields.init(pos);
+    sd.use_nnue = nnue_enabled();
+    if (sd.use_nnue)
+        sd.nnue.init(pos);
+    if (search_options.races && RaceTB.enabled() && pos.num_walls[WHITE] == 0 && pos.num_walls[BLACK] == 0)
+        sd.race = RaceTB.get(pos);
+    int best_score = eval(pos, sd);
 
-    for (int depth = 1; depth <= max_depth; ++depth) {
+    for (int depth = 1 + (thread_id & 1); depth <= std::min(max_depth, MAX_DEPTH - 1); ++depth) {
         Move current_iteration_best{};
-        time_up = false;
-        
-        // Pass &current_iteration_best to capture the move at the root
-        // nullptr would be passed inside the recursion automatically
-        int score = negamax(pos, depth, -INF, INF, nodes_searched, &current_iteration_best, end_time, time_up);
+
+        // Aspiration window around the last score, widened on the side that failed.
+        // Wins and losses are searched with the full window.
+        int delta = search_options.aspiration_window;
+        bool aspire = search_options.aspiration && depth >= 3 && !is_decisive(best_score);
+        int alpha = aspire ? best_score - delta : -INF;
+        int beta = aspire ? best_score + delta : INF;
+        int score;
+
+        while (true) {
+            // Pass &current_iteration_best to capture the move at the root
+            // nullptr would be passed inside the recursion automatically
+            score = negamax(pos, depth, 0, alpha, beta, MOVE_NONE, sd, &current_iteration_best);
+            if (sd.stop->load(std::memory_order_relaxed))
+                break;
+
+            if (score <= alpha)
+                alpha = std::max(alpha - delta, -INF);
+            else if (score >= beta)
+                beta = std::min(beta + delta, INF);
+            else
+                break;
+            delta *= 2;
+        }
         
-        if (time_up) {
+        if (sd.stop->load(std::memory_order_relaxed)) {
             break; // Discard results of incomplete search
         }
 
         best_score = score;
         best_move = current_iteration_best;
+        sd.completed_depth = depth;
+
+        if (sd.limits && sd.limits->on_iteration)
+            sd.limits->on_iteration(depth, best_score, sd.nodes_searched, best_move);
 
         // Optional: early exit on decisive result
-        if (best_score >= WIN_SCORE - 1 || best_score <= LOSS_SCORE + 1)
+        if (is_decisive(best_score))
+            break;
+        if (sd.time && !sd.time->start_next_iteration())
             break;
     }
-
-    // (Optional) expose nodes_searched somewhere (return via reference or global/log)
-    std::cout << "Nodes searched: " << nodes_searched << "\n";
     return best_score;
 }
 
-int eval(const Position& pos) {
-    Color us = pos.side_to_move;
-    Color opp = ~us;
+int iterative_deepening(Position& pos, int max_depth, int time_limit_ms, Move& best_move) {
+    SearchLimits limits;
+    limits.depth = max_depth;
+    limits.move_time = time_limit_ms;
+    return iterative_deepening(pos, limits, best_move);
+}
 
-    int my_dist = distance_to_goal(pos, us);
-    int opp_dist = distance_to_goal(pos, opp);
+int iterative_deepening(Position& pos, const SearchLimits& limits, Move& best_move) {
+    if (search_options.book) {
+        if (const BookEntry* e = Book.probe(pos)) {
+            best_move = e->move();
+            last_stats = SearchStats{0, 0, e->depth};
+            if (search_options.verbose)
+                std::cout << "Book move (depth " << int(e->depth) << ")\n";
+            return e->score;
+        }
+    }
 
-    // 1. Immediate Terminal Detection
-    if (my_dist == 0) return WIN_SCORE;
-    if (opp_dist == 0) return LOSS_SCORE;
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+
+    if (search_options.mcts) {
+        int score = Mcts.search(pos, limits, num_threads, best_move);
+        const MctsStats& st = Mcts.stats();
+        last_stats = SearchStats{st.playouts, std::chrono::duration<double>(clock::now() - start).count(),
+                                 st.max_depth};
+        if (limits.on_iteration)
+            limits.on_iteration(st.max_depth, score, st.playouts, best_move);
+        if (search_options.verbose)
+            Mcts.print_stats();
+        return score;
+    }
 
-    int score = 0;
+    TimeManager time(limits, pos);
+    const int max_depth = limits.depth;
 
-    // 2. Linear Distance Weighting
+    std::atomic<bool> stop{false};
+    while ((int)thread_data.size() < num_threads) {
+        thread_data.emplace_back(new SearchData);
+        thread_data.back()->clear();
+    }
+    auto& data = thread_data;
+    for (int i = 0; i < num_threads; ++i) {
+        data[i]->new_search();
+        data[i]->end_time = time.deadline();
+        data[i]->stop = &stop;
+        data[i]->is_main = i == 0;
+    }
+    data[0]->time = &time;
+    data[0]->limits = &limits;
+    data[0]->last_check = start;
+
+    TT.new_search();
+    TT.reset_stats();
+    DistCache.reset_stats();
+
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < num_threads; ++i) {
+        helpers.emplace_back([&, i] {
+            Position helper_pos = pos;
+            Move helper_move;
+            search_loop(helper_pos, max_depth, *data[i], i, helper_move);
+        });
+    }
+
+    int best_score = search_loop(pos, max_depth, *data[0], 0, best_move);
+
+    stop = true;
+    for (std::thread& t : helpers)
+        t.join();
+
+    long long nodes = 0;
+    for (const auto& sd : data)
+        nodes += sd->nodes_searched;
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    last_stats = SearchStats{nodes, seconds, data[0]->completed_depth};
+
+    if (!search_options.verbose)
+        return best_score;
+
+    std::cout << "Nodes searched: " << nodes << " (" << num_threads << " threads, "
+              << (long long)(nodes / std::max(seconds, 1e-9)) << " nodes/s)\n";
+    TT.print_stats();
+    DistCache.print_stats();
+    if (RaceTB.lookups)
+        RaceTB.print_stats();
+    data[0]->print_cutoff_stats();
+    return best_score;
+}
+
+EvalTerms eval_terms(const Position& pos, int my_dist, int opp_dist) {
+    Color us = pos.side_to_move;
+    Color opp = ~us;
+    EvalTerms t;
+
+    // 1. Linear Distance Weighting
     // We want to minimize our distance and maximize opponent distance.
     // Scaling factor ensures distance is the primary driver.
-    // Max distance is 81 squares (roughly), though path can be longer.
-    // 50 per step is substantial compared to walls.
-    score += (opp_dist - my_dist) * 50; 
+    // Max distance is SQ_NB squares (roughly), though path can be longer.
+    // The default 50 per step is substantial compared to walls.
+    t.distance = opp_dist - my_dist;
 
-    // 3. Tempo Bonus
+    // 2. Tempo Bonus
     // In a racing game, being the one whose turn it is is a massive advantage.
     // This breaks "ties" where both are the same distance away.
-    score += 10; 
+    t.tempo = 1;
 
-    // 4. Wall Value Scaling
+    // 3. Wall Value Scaling
     // Walls are worth more when you have many and the opponent has few.
     // We also value walls slightly more if the game is still early (long paths).
     int wall_diff = pos.num_walls[us] - pos.num_walls[opp];
-    int wall_multiplier = (my_dist > 4) ? 10 : 2; // Walls lose value as we approach goal
-    score += wall_diff * wall_multiplier;
+    t.wall = (my_dist > 4) ? wall_diff : 0; // Walls lose value as we approach goal
+    t.wall_late = (my_dist > 4) ? 0 : wall_diff;
 
-    // 5. Centrality Bonus (Heuristic)
+    // 4. Centrality Bonus (Heuristic)
     // Pawns in the center are harder to block than pawns on the edges.
     // Square coordinates usually range 0-8 for x and y.
     int my_file = file_of(pos.pawn[us]);
-    int centrality = 4 - std::abs(4 - my_file); // 0 at edges, 4 at center
-    score += centrality * 2;
+    t.centrality = FILE_NB / 2 - std::abs(FILE_NB / 2 - my_file); // 0 at edges, 4 at center on 9x9
+
+    return t;
+}
 
-    return score;
-}
\ No newline at end of file
+static int score_distances(const Position& pos, int my_dist, int opp_dist) {
+    // Immediate Terminal Detection
+    if (my_dist == 0) return WIN_SCORE;
+    if (opp_dist == 0) return LOSS_SCORE;
+
+    return eval_weights.score(eval_terms(pos, my_dist, opp_dist));
+}
+
+// The network's score, kept clear of the decisive range
+static int score_network(const Position& pos, const NnueAccumulator& acc, int my_dist, int opp_dist) {
+    if (my_dist == 0) return WIN_SCORE;
+    if (opp_dist == 0) return LOSS_SCORE;
+    return std::clamp(Nnue.evaluate(pos, acc, my_dist, opp_dist), -DECISIVE_SCORE + 1, DECISIVE_SCORE - 1);
+}
+
+int eval(const Position& pos) {
+    const int my_dist = DistCache.distance(pos, pos.side_to_move);
+    const int opp_dist = DistCache.distance(pos, ~pos.side_to_move);
+    if (!nnue_enabled())
+        return score_distances(pos, my_dist, opp_dist);
+
+    NnueAccumulator acc;
+    Nnue.refresh(pos, acc);
+    return score_network(pos, acc, my_dist, opp_dist);
+}
+
+int eval(const Position& pos, const DistanceFields& fields) {
+    const Color us = pos.side_to_move;
+    const int my_dist = fields.distance(us, pos.pawn[us]);
+    const int opp_dist = fields.distance(~us, pos.pawn[~us]);
+    if (!nnue_enabled())
+        return score_distances(pos, my_dist, opp_dist);
+
+    NnueAccumulator acc;
+    Nnue.refresh(pos, acc);
+    return score_network(pos, acc, my_dist, opp_dist);
+}
+
+int eval(const Position& pos, const SearchData& sd) {
+    if (!sd.use_nnue)
+        return eval(pos, sd.fields);
+
+    const Color us = pos.side_to_move;
+    return score_network(pos, sd.nnue.top(), sd.fields.distance(us, pos.pawn[us]),
+                         sd.fields.distance(~us, pos.pawn[~us]));
+}
@@ -2,6 +2,14 @@
 
 #include "position.h"
 #include "movegen.h"
+#include "tt.h"
+#include "movepick.h"
+#include "distfield.h"
+#include "endgame.h"
+#include "timeman.h"
+#include "mcts.h"
+#include "nnue.h"
+#include <atomic>
 #include <limits>
 #include <chrono>
 
@@ -9,13 +17,110 @@ constexpr int WIN_SCORE = 100'000;
 constexpr int LOSS_SCORE = -WIN_SCORE;
 constexpr int INF = 300'000;
 
-constexpr int WALL_VALUE = 10; // tune experimentally
+// A game ending at remaining depth d scores WIN_SCORE + d (LOSS_SCORE - d). Races
+// are resolved past the horizon, so d goes down to -RACE_OPEN.
+constexpr int DECISIVE_SCORE = WIN_SCORE - MAX_DEPTH - RACE_OPEN;
+inline bool is_decisive(int score) { return std::abs(score) >= DECISIVE_SCORE; }
 
-int negamax(Position& pos, int depth, int alpha, int beta, int& nodes_searched);
+// What each eval weight is multiplied by: away from won and lost positions the
+// hand-written eval is their weighted sum, which tuning (tune.cpp) relies on
+struct EvalTerms {
+    int distance;
+    int tempo;
+    int wall;
+    int wall_late;
+    int centrality;
+};
 
-int negamax_root(Position& pos, int depth, int alpha, int beta, Move& best_move,
-                 std::chrono::steady_clock::time_point end_time, bool& time_up, int& nodes_searched);
+// Evaluation weights, kept at runtime so matches and tuning can vary them
+struct EvalWeights {
+    int distance = 50;      // per step of goal distance ahead of the opponent
+    int tempo = 10;         // for being the side to move
+    int wall = 10;          // per wall more than the opponent, while our path is long
+    int wall_late = 2;      // the same once we are within 4 steps of the goal
+    int centrality = 2;     // per file away from the edge
 
+    int score(const EvalTerms& t) const {
+        return t.distance * distance + t.tempo * tempo + t.wall * wall + t.wall_late * wall_late
+             + t.centrality * centrality;
+    }
+};
+
+extern EvalWeights eval_weights;
+
+// Search features that can be switched off to measure what they gain
+struct SearchOptions {
+    bool pvs = true;          // null-window search after the first move
+    bool aspiration = true;   // root window around the previous iteration's score
+    bool lmr = true;          // late move reductions for history-ordered walls
+    int aspiration_window = 60;
+    bool races = true;        // exact results once both sides are out of walls
+    bool book = true;         // play from the opening book (see book.h) when it has the position
+    bool verbose = true;      // print node and table statistics after each search
+    bool mcts = false;        // Monte Carlo tree search (mcts.h) instead of alpha-beta
+    bool nnue = false;        // the network (nnue.h) instead of the hand-written eval, once one is loaded
+};
+
+extern SearchOptions search_options;
+
+// State of one search thread, threaded through negamax.
+// Everything but the stop flag is private to the thread. The threads' data lives
+// from one search to the next, so the history carries over between moves.
+struct SearchData {
+    long long nodes_searched = 0;
+    std::chrono::steady_clock::time_point end_time;
+    // shared by all threads of a search; only the main thread watches the clock
+    std::atomic<bool>* stop = nullptr;
+    bool is_main = true;
+    int completed_depth = 0;
+
+    // Main thread only: limits, and the node counter between clock reads. Nodes
+    // vary a lot in cost, so the interval adapts to keep reads about 1 ms apart.
+    TimeManager* time = nullptr;
+    const SearchLimits* limits = nullptr;
+    int check_interval = 256;
+    int check_countdown = 256;
+    std::chrono::steady_clock::time_point last_check;
+
+    History history;
+    // distance maps of the position being searched, so leaves need no BFS
+    DistanceFields fields;
+    // network accumulators of the same line, kept only while the network evaluates
+    NnueStack nnue;
+    bool use_nnue = false;
+    // race solution for the root's walls, when the root has no walls left to place
+    std::shared_ptr<const RaceSolution> race;
+    // beta cutoffs per remaining depth, and how many came from the first move searched
+    uint64_t cutoffs[MAX_DEPTH + 1];
+    uint64_t first_move_cutoffs[MAX_DEPTH + 1];
+
+    void clear();
+    // resets everything but the (aged) history
+    void new_search();
+    void print_cutoff_stats() const;
+};
+
+int negamax(Position& pos, int depth, int ply, int alpha, int beta, Move prev,
+            SearchData& sd, Move* best_move);
+
+// Threads used by iterative_deepening (Lazy SMP: helpers search the same root at
+// staggered depths and share the transposition table)
+void set_search_threads(int threads);
+int search_threads();
+// Forgets the transposition table, all history and the MCTS tree, for a new game or an
+// unrelated position
+void new_game();
+
+// Totals of the last iterative_deepening call, over all threads
+struct SearchStats {
+    long long nodes = 0;
+    double seconds = 0;
+    int depth = 0;   // last iteration the main thread completed
+};
+const SearchStats& last_search_stats();
+
+int iterative_deepening(Position& pos, const SearchLimits& limits, Move& best_move);
+// Fixed depth and time per move (0 for no limit)
 int iterative_deepening(Position& pos, int max_depth, int time_limit_ms, Move& best_move);
 
 // Convenience overload if caller does not need the move
@@ -24,4 +129,12 @@ inline int iterative_deepening(Position& pos, int max_depth, int time_limit_ms)
     return iterative_deepening(pos, max_depth, time_limit_ms, dummy);
 }
 
-int eval(const Position& pos);
\ No newline at end of file
+// Hand-written or network evaluation, by search_options.nnue
+int eval(const Position& pos);
+// Same score, reading the pawns' distances from maps kept in step with pos
+int eval(const Position& pos, const DistanceFields& fields);
+// Same again, with accumulators kept in step with pos when the network is in use
+int eval(const Position& pos, const SearchData& sd);
+// The terms of the hand-written eval, given both pawns' goal distances
+EvalTerms eval_terms(const Position& pos, int my_dist, int opp_dist);
+inline bool nnue_enabled() { return search_options.nnue && Nnue.loaded(); }
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "stats.h"
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+std::mutex totals_mutex;
+Stats totals{};
+
+template<size_t N>
+void add_array(uint64_t (&to)[N], const uint64_t (&from)[N]) {
+    for (size_t i = 0; i < N; ++i)
+        to[i] += from[i];
+}
+
+// The array without its trailing zeros
+template<size_t N>
+void write_array(std::ostream& os, const uint64_t (&a)[N]) {
+    size_t n = N;
+    while (n > 0 && a[n - 1] == 0)
+        --n;
+    os << "[";
+    for (size_t i = 0; i < n; ++i)
+        os << (i ? ", " : "") << a[i];
+    os << "]";
+}
+
+}
+
+#ifdef STATS
+
+thread_local ThreadStats thread_stats;
+
+ThreadStats::~ThreadStats() {
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    totals.add(stats);
+}
+
+#endif
+
+void Stats::add(const Stats& other) {
+    add_array(nodes_by_ply, other.nodes_by_ply);
+    add_array(cutoffs_by_move, other.cutoffs_by_move);
+    bfs_calls += other.bfs_calls;
+    bfs_layers += other.bfs_layers;
+    wall_candidates += other.wall_candidates;
+    walls_path_checked += other.walls_path_checked;
+    walls_accepted += other.walls_accepted;
+    movegen_ns += other.movegen_ns;
+    eval_ns += other.eval_ns;
+    search_ns += other.search_ns;
+}
+
+std::string Stats::to_json() const {
+    std::ostringstream os;
+#ifdef STATS
+    os << "{\n  \"enabled\": true,\n";
+#else
+    os << "{\n  \"enabled\": false,\n";
+#endif
+    os << "  \"nodes_by_ply\": ";
+    write_array(os, nodes_by_ply);
+    os << ",\n  \"cutoffs_by_move\": ";
+    write_array(os, cutoffs_by_move);
+    os << ",\n  \"bfs_calls\": " << bfs_calls
+       << ",\n  \"bfs_layers\": " << bfs_layers
+       << ",\n  \"wall_candidates\": " << wall_candidates
+       << ",\n  \"walls_path_checked\": " << walls_path_checked
+       << ",\n  \"walls_accepted\": " << walls_accepted
+       << ",\n  \"movegen_ns\": " << movegen_ns
+       << ",\n  \"eval_ns\": " << eval_ns
+       << ",\n  \"search_ns\": " << search_ns
+       << "\n}\n";
+    return os.str();
+}
+
+Stats stats_collect() {
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    Stats s = totals;
+#ifdef STATS
+    s.add(thread_stats.stats);
+#endif
+    return s;
+}
+
+void stats_reset() {
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    totals = Stats{};
+#ifdef STATS
+    thread_stats.stats = Stats{};
+#endif
+}
+
+bool stats_write_json(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    file << stats_collect().to_json();
+    return bool(file);
+}
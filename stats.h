@@ -0,0 +1,72 @@
+#pragma once
+
+#include "types.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Search and move generation counters, compiled in with make STATS=1 (-DSTATS).
+// Without it the STATS_ macros expand to nothing and their arguments are never
+// evaluated, so normal builds pay nothing.
+//
+// Each thread counts into a thread_local block of its own, which is added to
+// the process totals when the thread ends. Search helpers are joined at the end
+// of every search, so stats_collect() after a search sees all of it.
+struct Stats {
+    static constexpr int MOVE_INDEXES = 64;   // the last bucket takes every later move
+
+    uint64_t nodes_by_ply[MAX_DEPTH + 1];
+    uint64_t cutoffs_by_move[MOVE_INDEXES];   // beta cutoffs by the index of the move that made them
+    uint64_t bfs_calls;                       // flood fills over the board
+    uint64_t bfs_layers;                      // layers they expanded
+    uint64_t wall_candidates;                 // walls considered by move generation and the picker
+    uint64_t walls_path_checked;              // the ones that could close a loop, so needed a path check
+    uint64_t walls_accepted;                  // the ones handed out as legal
+    uint64_t movegen_ns;                      // generating and ordering moves
+    uint64_t eval_ns;                         // evaluating leaves
+    uint64_t search_ns;                       // whole searches, per thread, the above included
+
+    void add(const Stats& other);
+    std::string to_json() const;
+};
+
+// The totals of the ended threads plus the calling thread's own counts
+Stats stats_collect();
+void stats_reset();
+// Writes stats_collect() as JSON; false if the file can't be written
+bool stats_write_json(const std::string& path);
+
+#ifdef STATS
+
+struct ThreadStats {
+    Stats stats{};
+    ~ThreadStats();
+};
+
+extern thread_local ThreadStats thread_stats;
+
+// Adds the time until the end of its scope to a counter
+class StatsTimer {
+public:
+    explicit StatsTimer(uint64_t& counter) : counter(counter), start(std::chrono::steady_clock::now()) {}
+    ~StatsTimer() {
+        counter += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    uint64_t& counter;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define STATS_ADD(field, n) (thread_stats.stats.field += (n))
+#define STATS_TIMER(field) StatsTimer stats_timer_##field(thread_stats.stats.field)
+
+#else
+
+#define STATS_ADD(field, n) ((void)0)
+#define STATS_TIMER(field) ((void)0)
+
+#endif
+
+#define STATS_INC(field) STATS_ADD(field, 1)
@@ -0,0 +1,58 @@
+#include "timeman.h"
+#include "movegen.h"
+#include <algorithm>
+
+namespace {
+// kept back on the clock for everything outside the search
+constexpr int MOVE_OVERHEAD = 10;
+}
+
+TimeManager::TimeManager(const SearchLimits& limits, const Position& pos) : start(clock::now()) {
+    if (limits.move_time > 0) {
+        soft = hard = limits.move_time;
+        fixed = true;
+        return;
+    }
+    if (limits.time_left <= 0)
+        return;
+
+    // Every move we make is a step or a wall, so our distance plus our walls is
+    // about how many moves are left, unless the control ends sooner
+    const Color us = pos.side_to_move;
+    int moves_left = std::max(8, distance_to_goal(pos, us) + pos.num_walls[us]);
+    if (limits.moves_to_go > 0)
+        moves_left = std::min(moves_left, limits.moves_to_go);
+
+    const int available = std::max(1, limits.time_left - MOVE_OVERHEAD);
+    const int base = available / moves_left + limits.increment * 3 / 4;
+    soft = std::min(base, available);
+    hard = std::min({base * 4, available / 3 + limits.increment, available});
+    hard = std::max(hard, soft);
+}
+
+double TimeManager::elapsed() const {
+    return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+}
+
+TimeManager::clock::time_point TimeManager::deadline() const {
+    return hard > 0 ? start + std::chrono::milliseconds(hard) : clock::time_point::max();
+}
+
+bool TimeManager::start_next_iteration() {
+    const double now = elapsed();
+    prev_iteration = last_iteration;
+    last_iteration = now - iteration_end;
+    iteration_end = now;
+
+    // time not spent on a fixed-time move is lost anyway
+    if (hard == 0 || fixed)
+        return true;
+    if (now >= soft)
+        return false;
+
+    // iterations too short to time say nothing about the next one
+    if (prev_iteration < 0.05)
+        return true;
+    const double branching = std::clamp(last_iteration / prev_iteration, 1.5, 10.0);
+    return now + last_iteration * branching <= hard;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "position.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+// What a search may spend, as given by the caller; times in milliseconds, 0 for none
+struct SearchLimits {
+    int depth = MAX_DEPTH - 1;
+    int move_time = 0;        // fixed time for this move
+    int time_left = 0;        // on the side to move's clock
+    int increment = 0;        // added to that clock after the move
+    int moves_to_go = 0;      // until the next time control, 0 for the rest of the game
+    long long nodes = 0;      // main thread nodes, so single-threaded runs are reproducible
+
+    // set by the caller to end the search early, e.g. from another thread
+    const std::atomic<bool>* abort = nullptr;
+    // called by the main thread after each completed iteration, with its node count
+    std::function<void(int depth, int score, long long nodes, Move best)> on_iteration;
+};
+
+// Splits the clock into a soft limit, after which no new iteration starts, and a
+// hard limit, at which the search is stopped wherever it is. An iteration that is
+// not expected to finish before the hard limit isn't started either: the next one
+// is predicted to take as much longer as the last one did over the one before.
+// A fixed move time is a hard limit only.
+class TimeManager {
+public:
+    using clock = std::chrono::steady_clock;
+
+    TimeManager(const SearchLimits& limits, const Position& pos);
+
+    double elapsed() const;   // ms
+    int soft_limit() const { return soft; }
+    int hard_limit() const { return hard; }
+    clock::time_point deadline() const;
+
+    // called by the main thread after each iteration; false to stop deepening
+    bool start_next_iteration();
+
+private:
+    clock::time_point start;
+    int soft = 0;
+    int hard = 0;
+    bool fixed = false;
+    double iteration_end = 0;
+    double last_iteration = 0;
+    double prev_iteration = 0;
+};
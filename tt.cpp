@@ -0,0 +1,172 @@
+#include "tt.h"
+#include "search.h"
+#include <iostream>
+#include <limits>
+#include <mutex>
+
+TranspositionTable TT;
+
+// data layout: score (32) | from (8) | to (8) | type (2) | bound (2) | depth (8) | generation (4)
+namespace {
+
+constexpr int GENERATION_BITS = 4;
+constexpr int GENERATION_MASK = (1 << GENERATION_BITS) - 1;
+
+uint64_t pack(Move move, int score, int depth, Bound bound, uint8_t generation) {
+    return uint64_t(uint32_t(score))
+         | uint64_t(uint8_t(move.from)) << 32
+         | uint64_t(uint8_t(move.to)) << 40
+         | uint64_t(move.type) << 48
+         | uint64_t(bound) << 50
+         | uint64_t(uint8_t(depth)) << 52
+         | uint64_t(generation & GENERATION_MASK) << 60;
+}
+
+int data_depth(uint64_t data) { return int((data >> 52) & 0xFF); }
+int data_generation(uint64_t data) { return int(data >> 60); }
+Bound data_bound(uint64_t data) { return Bound((data >> 50) & 3); }
+
+void unpack(uint64_t data, TTData& tt_data) {
+    tt_data.score = int32_t(uint32_t(data));
+    tt_data.move = Move{Square(uint8_t(data >> 32)), Square(uint8_t(data >> 40)), MoveType((data >> 48) & 3)};
+    tt_data.bound = data_bound(data);
+    tt_data.depth = data_depth(data);
+}
+
+std::mutex stats_mutex;
+TTStats ended_threads;
+
+struct ThreadCounts {
+    TTStats stats;
+    ~ThreadCounts() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        ended_threads.probes += stats.probes;
+        ended_threads.hits += stats.hits;
+        ended_threads.cutoffs += stats.cutoffs;
+    }
+};
+
+thread_local ThreadCounts thread_counts;
+
+} // namespace
+
+TranspositionTable::TranspositionTable(size_t size_mb) {
+    resize(size_mb);
+}
+
+void TranspositionTable::resize(size_t size_mb) {
+    num_buckets = std::max<size_t>(1, size_mb * 1024 * 1024 / sizeof(TTBucket));
+    buckets.reset(new TTBucket[num_buckets]);
+    clear();
+}
+
+void TranspositionTable::clear() {
+    for (size_t i = 0; i < num_buckets; ++i) {
+        for (TTEntry& e : buckets[i].entries) {
+            e.key_xor_data.store(0, std::memory_order_relaxed);
+            e.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    generation = 0;
+}
+
+void TranspositionTable::new_search() {
+    generation = (generation + 1) & GENERATION_MASK;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData& tt_data) {
+    thread_counts.stats.probes++;
+
+    for (const TTEntry& e : bucket(key)->entries) {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        if ((e.key_xor_data.load(std::memory_order_relaxed) ^ data) == key && data_bound(data) != BOUND_NONE) {
+            unpack(data, tt_data);
+            thread_counts.stats.hits++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Same position: overwrite unless the old entry is deeper and from this search.
+// Otherwise replace the slot with the lowest depth, counting older searches as shallower.
+void TranspositionTable::store(uint64_t key, Move move, int score, int depth, Bound bound) {
+    TTEntry* replace = nullptr;
+    int worst = std::numeric_limits<int>::max();
+
+    for (TTEntry& e : bucket(key)->entries) {
+        uint64_t data = e.data.load(std::memory_order_relaxed);
+        if ((e.key_xor_data.load(std::memory_order_relaxed) ^ data) == key) {
+            if (bound != BOUND_EXACT && depth < data_depth(data) && data_generation(data) == generation)
+                return;
+            // keep the old best move if this search did not produce one
+            if (move.is_none()) {
+                TTData old;
+                unpack(data, old);
+                move = old.move;
+            }
+            replace = &e;
+            break;
+        }
+
+        int age = (generation - data_generation(data)) & GENERATION_MASK;
+        int value = data_bound(data) == BOUND_NONE ? -1000 : data_depth(data) - 8 * age;
+        if (value < worst) {
+            worst = value;
+            replace = &e;
+        }
+    }
+
+    uint64_t data = pack(move, score, depth, bound, generation);
+    replace->key_xor_data.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+    int used = 0;
+    size_t sample = std::min<size_t>(num_buckets, 250);
+    for (size_t i = 0; i < sample; ++i)
+        for (const TTEntry& e : buckets[i].entries) {
+            uint64_t data = e.data.load(std::memory_order_relaxed);
+            used += data_bound(data) != BOUND_NONE && data_generation(data) == generation;
+        }
+    return int(used * 1000 / (sample * BUCKET_SIZE));
+}
+
+void TranspositionTable::count_cutoff() {
+    thread_counts.stats.cutoffs++;
+}
+
+TTStats TranspositionTable::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    TTStats s = ended_threads;
+    s.probes += thread_counts.stats.probes;
+    s.hits += thread_counts.stats.hits;
+    s.cutoffs += thread_counts.stats.cutoffs;
+    return s;
+}
+
+void TranspositionTable::reset_stats() {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    ended_threads = TTStats{};
+    thread_counts.stats = TTStats{};
+}
+
+void TranspositionTable::print_stats() const {
+    const TTStats s = stats();
+    const uint64_t p = s.probes, h = s.hits, c = s.cutoffs;
+    std::cout << "TT probes: " << p << ", hits: " << h << " (" << (p ? 100.0 * h / p : 0.0) << "%)"
+              << ", cutoffs: " << c << ", hashfull: " << hashfull() << " permille\n";
+}
+
+int score_to_tt(int score, int depth) {
+    return score >= DECISIVE_SCORE ? score - depth
+         : score <= -DECISIVE_SCORE ? score + depth
+         : score;
+}
+
+int score_from_tt(int score, int depth) {
+    return score >= DECISIVE_SCORE ? score + depth
+         : score <= -DECISIVE_SCORE ? score - depth
+         : score;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "types.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+enum Bound : uint8_t {
+    BOUND_NONE,
+    BOUND_UPPER,
+    BOUND_LOWER,
+    BOUND_EXACT = BOUND_UPPER | BOUND_LOWER
+};
+
+struct TTData {
+    Move move;
+    int score;
+    int depth;
+    Bound bound;
+};
+
+// Lockless slot: the key is stored XORed with the data, so an entry torn by a
+// concurrent write simply fails to match instead of returning mixed data
+struct TTEntry {
+    std::atomic<uint64_t> key_xor_data;
+    std::atomic<uint64_t> data;
+};
+
+constexpr int BUCKET_SIZE = 4;
+
+struct TTStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t cutoffs = 0;
+};
+
+// one cache line per probe
+struct alignas(64) TTBucket {
+    TTEntry entries[BUCKET_SIZE];
+};
+
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t size_mb = 16);
+
+    void resize(size_t size_mb);
+    void clear();
+    // ages the entries of earlier searches so they get replaced first
+    void new_search();
+
+    bool probe(uint64_t key, TTData& tt_data);
+    void store(uint64_t key, Move move, int score, int depth, Bound bound);
+
+    // permille of sampled slots written by the current search
+    int hashfull() const;
+
+    // Each thread counts into a block of its own, added to the totals when the
+    // thread ends, so probes never write a line the other threads read. Search
+    // helpers end with every search, so stats() after a search sees all of it.
+    void count_cutoff();
+    // the totals of the ended threads plus the calling thread's own counts
+    TTStats stats() const;
+    void reset_stats();
+    void print_stats() const;
+
+private:
+    TTBucket* bucket(uint64_t key) const {
+        return &buckets[(unsigned __int128)key * num_buckets >> 64];
+    }
+
+    std::unique_ptr<TTBucket[]> buckets;
+    size_t num_buckets = 0;
+    uint8_t generation = 0;
+};
+
+extern TranspositionTable TT;
+
+// Win/loss scores count the remaining depth, so they are stored relative to the node
+int score_to_tt(int score, int depth);
+int score_from_tt(int score, int depth);
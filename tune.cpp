@@ -0,0 +1,218 @@
+// Texel tuning of the hand-written eval's weights against game outcomes.
+// Positions come from record files (record.h, e.g. written by generate_records).
+// Each position's goal distances are found once at load time and kept as the
+// eval's terms (EvalTerms), so an epoch is just weighted sums over memory, split
+// across threads. The loss is the squared error between the result (blended with
+// the recorded search score by --lambda) and a logistic of the eval whose scale
+// K is fitted first; the weights then move by coordinate descent in whole steps.
+//
+//   ./tune --data selfplay.pos --threads 8
+//   ./tune --data a.pos --data b.pos --lambda 0.3 --epochs 50
+
+#include "position.h"
+#include "movegen.h"
+#include "search.h"
+#include "record.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Sample {
+    EvalTerms terms;
+    float result;       // 1 won, 0.5 drawn, 0 lost, from the side to move
+    float search;       // the recorded search score as a win rate, once K is known
+    int32_t score;
+};
+
+struct TuneConfig {
+    std::vector<std::string> data;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int epochs = 100;
+    double lambda = 0;      // weight of the search score in the target
+    double k = 0;           // logistic scale; 0 to fit it
+};
+
+struct Param {
+    const char* name;
+    int EvalWeights::* weight;
+};
+
+constexpr Param PARAMS[] = {
+    {"distance", &EvalWeights::distance},
+    {"tempo", &EvalWeights::tempo},
+    {"wall", &EvalWeights::wall},
+    {"wall_late", &EvalWeights::wall_late},
+    {"centrality", &EvalWeights::centrality},
+};
+
+double win_rate(double score, double k) {
+    return 1 / (1 + std::pow(10.0, -k * score / 400));
+}
+
+// Sums f(i) over [0, n) on the given number of threads
+template<typename F>
+double parallel_sum(size_t n, int threads, F&& f) {
+    std::vector<double> sums(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            double sum = 0;
+            for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i)
+                sum += f(i);
+            sums[t] = sum;
+        });
+    for (auto& w : workers)
+        w.join();
+    double total = 0;
+    for (double s : sums)
+        total += s;
+    return total;
+}
+
+// Positions that are still open, with their terms; the distance searches run
+// on all threads, a chunk of the mapping at a time
+void load(const std::string& path, int threads, std::vector<Sample>& samples) {
+    RecordFile file;
+    if (!file.open(path)) {
+        std::cout << "Could not read records " << path << "\n";
+        return;
+    }
+
+    const size_t before = samples.size();
+    std::vector<Sample> chunk_samples;
+    std::vector<char> keep;
+    file.scan([&](const PositionRecord* records, size_t n) {
+        chunk_samples.resize(n);
+        keep.assign(n, 0);
+        parallel_sum(n, threads, [&](size_t i) {
+            Position pos;
+            if (!unpack(records[i], pos))
+                return 0.0;
+            const Color us = pos.side_to_move;
+            const int my_dist = distance_to_goal(pos, us), opp_dist = distance_to_goal(pos, ~us);
+            if (my_dist == 0 || opp_dist == 0 || my_dist >= NO_PATH || opp_dist >= NO_PATH)
+                return 0.0;
+            chunk_samples[i] = Sample{eval_terms(pos, my_dist, opp_dist),
+                                      float(records[i].result + 1) / 2, 0, records[i].score};
+            keep[i] = 1;
+            return 0.0;
+        });
+        for (size_t i = 0; i < n; ++i)
+            if (keep[i])
+                samples.push_back(chunk_samples[i]);
+    });
+    std::cout << path << ": " << file.size() << " records, " << samples.size() - before << " open positions\n";
+}
+
+double error(const std::vector<Sample>& samples, const EvalWeights& w, double k, double lambda, int threads) {
+    return parallel_sum(samples.size(), threads, [&](size_t i) {
+        const Sample& s = samples[i];
+        const double target = lambda * s.search + (1 - lambda) * s.result;
+        const double e = target - win_rate(w.score(s.terms), k);
+        return e * e;
+    }) / samples.size();
+}
+
+// Ternary search of the scale that best fits the current weights to the results
+double fit_k(const std::vector<Sample>& samples, const EvalWeights& w, int threads) {
+    double lo = 0.01, hi = 5;
+    for (int i = 0; i < 40; ++i) {
+        const double a = lo + (hi - lo) / 3, b = hi - (hi - lo) / 3;
+        if (error(samples, w, a, 0, threads) < error(samples, w, b, 0, threads))
+            hi = b;
+        else
+            lo = a;
+    }
+    return (lo + hi) / 2;
+}
+
+void print_weights(const EvalWeights& w) {
+    std::cout << "struct EvalWeights {\n";
+    for (const Param& p : PARAMS)
+        std::cout << "    int " << p.name << " = " << w.*p.weight << ";\n";
+    std::cout << "};\nmatch spec: ";
+    for (const Param& p : PARAMS)
+        std::cout << (&p == PARAMS ? "" : ",") << p.name << "=" << w.*p.weight;
+    std::cout << "\n";
+}
+
+void usage() {
+    std::cout << "usage: tune --data FILE [--data FILE ...] [--threads N] [--epochs N]\n"
+                 "            [--lambda L] [--k K]\n"
+                 "--lambda: weight of the recorded search score against the game result (0..1)\n"
+                 "--k:      logistic scale of the eval, fitted to the start weights if not given\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    TuneConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (!ok) {}
+        else if (arg == "--data") config.data.push_back(value);
+        else if (arg == "--threads") config.threads = std::max(1, std::stoi(value));
+        else if (arg == "--epochs") config.epochs = std::stoi(value);
+        else if (arg == "--lambda") config.lambda = std::stod(value);
+        else if (arg == "--k") config.k = std::stod(value);
+        else ok = false;
+        if (!ok) {
+            usage();
+            return 1;
+        }
+        ++i;
+    }
+    if (config.data.empty()) {
+        usage();
+        return 1;
+    }
+
+    init();
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Sample> samples;
+    for (const std::string& path : config.data)
+        load(path, config.threads, samples);
+    if (samples.empty())
+        return 1;
+
+    EvalWeights w = eval_weights;
+    const double k = config.k > 0 ? config.k : fit_k(samples, w, config.threads);
+    for (Sample& s : samples)
+        s.search = float(win_rate(s.score, k));
+
+    double best = error(samples, w, k, config.lambda, config.threads);
+    std::cout << samples.size() << " positions, K " << k << ", start error " << best << "\n";
+
+    // Coordinate descent: a step up or down on one weight at a time, kept if it
+    // helps, with the step halved once a whole pass finds nothing
+    for (int epoch = 1, step = 8; epoch <= config.epochs && step > 0; ++epoch) {
+        bool improved = false;
+        for (const Param& p : PARAMS)
+            for (int dir : {step, -step}) {
+                EvalWeights trial = w;
+                trial.*p.weight += dir;
+                const double e = error(samples, trial, k, config.lambda, config.threads);
+                if (e < best) {
+                    best = e;
+                    w = trial;
+                    improved = true;
+                    break;
+                }
+            }
+        if (!improved)
+            step /= 2;
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "epoch " << epoch << "  step " << step << "  error " << best << "  " << seconds << " s\n";
+    }
+
+    print_weights(w);
+    return 0;
+}
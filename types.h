@@ -4,7 +4,17 @@
 #include <cstdint>
 #include <iostream>
 
+// Board dimension, fixed at build time: make BOARD_SIZE=7 (or 5) builds the
+// smaller variants for trying out search ideas quickly. Books, networks and
+// record files only fit the board they were made on. Square names are only
+// defined for the standard 9x9 board.
+#ifndef BOARD_SIZE
+#define BOARD_SIZE 9
+#endif
+static_assert(BOARD_SIZE >= 3 && BOARD_SIZE <= 9 && BOARD_SIZE % 2 == 1, "BOARD_SIZE must be odd and from 3 to 9");
+
 enum Square : int16_t {
+#if BOARD_SIZE == 9
     SQ_A1, SQ_B1, SQ_C1, SQ_D1, SQ_E1, SQ_F1, SQ_G1, SQ_H1, SQ_I1,
     SQ_A2, SQ_B2, SQ_C2, SQ_D2, SQ_E2, SQ_F2, SQ_G2, SQ_H2, SQ_I2,
     SQ_A3, SQ_B3, SQ_C3, SQ_D3, SQ_E3, SQ_F3, SQ_G3, SQ_H3, SQ_I3,
@@ -14,10 +24,18 @@ enum Square : int16_t {
     SQ_A7, SQ_B7, SQ_C7, SQ_D7, SQ_E7, SQ_F7, SQ_G7, SQ_H7, SQ_I7,
     SQ_A8, SQ_B8, SQ_C8, SQ_D8, SQ_E8, SQ_F8, SQ_G8, SQ_H8, SQ_I8,
     SQ_A9, SQ_B9, SQ_C9, SQ_D9, SQ_E9, SQ_F9, SQ_G9, SQ_H9, SQ_I9,
-    SQ_NB = 81,
+#else
+    SQ_A1,
+#endif
+    SQ_NB = BOARD_SIZE * BOARD_SIZE,
     SQ_NONE = 255
 };
 
+// walls each player starts with: 10 on the standard board, fewer on the small ones
+constexpr int WALLS_PER_PLAYER = BOARD_SIZE == 9 ? 10 : BOARD_SIZE + 1;
+
+constexpr int MAX_DEPTH = 128;
+
 enum MoveType {
     PAWN,
     H_WALL,
@@ -27,7 +45,7 @@ enum MoveType {
 
 // maybe dont need diagonals
 enum Direction : int16_t { 
-    NORTH = 9,
+    NORTH = BOARD_SIZE,
     EAST = 1,
     SOUTH = -NORTH,
     WEST = -EAST,
@@ -57,7 +75,7 @@ enum File : int16_t {
     FILE_G,
     FILE_H,
     FILE_I,
-    FILE_NB = 9
+    FILE_NB = BOARD_SIZE
 };
 
 
@@ -71,7 +89,7 @@ enum Rank : int16_t {
     RANK_7,
     RANK_8,
     RANK_9,
-    RANK_NB = 9
+    RANK_NB = BOARD_SIZE
 };
 
 #define ENABLE_INCR_OPERATORS_ON(T) \
@@ -84,28 +102,27 @@ ENABLE_INCR_OPERATORS_ON(Rank)
 
 #undef ENABLE_INCR_OPERATORS_ON
 
-constexpr Square make_square(Rank r, File f) { return Square(r * 9 + f); }
-constexpr Rank rank_of(Square s) { return Rank(s / 9); }
-constexpr File file_of(Square s) { return File(s % 9); }
+// the last rank and file, rank 9 and file I on the standard board
+constexpr Rank RANK_LAST = Rank(RANK_NB - 1);
+constexpr File FILE_LAST = File(FILE_NB - 1);
+
+constexpr Square make_square(Rank r, File f) { return Square(r * BOARD_SIZE + f); }
+constexpr Rank rank_of(Square s) { return Rank(s / BOARD_SIZE); }
+constexpr File file_of(Square s) { return File(s % BOARD_SIZE); }
 
 constexpr Square operator+(Square s, Direction d) { return Square(int(s) + int(d));}
 constexpr Square operator-(Square s, Direction d) { return Square(int(s) - int(d));}
 
 inline const char* square_to_string(Square s) {
-    static const char* names[] = {
-        "SQ_A1","SQ_B1","SQ_C1","SQ_D1","SQ_E1","SQ_F1","SQ_G1","SQ_H1","SQ_I1",
-        "SQ_A2","SQ_B2","SQ_C2","SQ_D2","SQ_E2","SQ_F2","SQ_G2","SQ_H2","SQ_I2",
-        "SQ_A3","SQ_B3","SQ_C3","SQ_D3","SQ_E3","SQ_F3","SQ_G3","SQ_H3","SQ_I3",
-        "SQ_A4","SQ_B4","SQ_C4","SQ_D4","SQ_E4","SQ_F4","SQ_G4","SQ_H4","SQ_I4",
-        "SQ_A5","SQ_B5","SQ_C5","SQ_D5","SQ_E5","SQ_F5","SQ_G5","SQ_H5","SQ_I5",
-        "SQ_A6","SQ_B6","SQ_C6","SQ_D6","SQ_E6","SQ_F6","SQ_G6","SQ_H6","SQ_I6",
-        "SQ_A7","SQ_B7","SQ_C7","SQ_D7","SQ_E7","SQ_F7","SQ_G7","SQ_H7","SQ_I7",
-        "SQ_A8","SQ_B8","SQ_C8","SQ_D8","SQ_E8","SQ_F8","SQ_G8","SQ_H8","SQ_I8",
-        "SQ_A9","SQ_B9","SQ_C9","SQ_D9","SQ_E9","SQ_F9","SQ_G9","SQ_H9","SQ_I9"
-    };
+    static const std::array<std::array<char, 6>, SQ_NB> names = [] {
+        std::array<std::array<char, 6>, SQ_NB> n{};
+        for (int i = 0; i < SQ_NB; ++i)
+            n[i] = {'S', 'Q', '_', char('A' + i % BOARD_SIZE), char('1' + i / BOARD_SIZE), 0};
+        return n;
+    }();
     int idx = int(s);
     if (s == SQ_NONE) return "SQ_NONE";
-    if (idx >= 0 && idx < SQ_NB) return names[idx];
+    if (idx >= 0 && idx < SQ_NB) return names[idx].data();
     return "UNKNOWN_SQ";
 }
 
@@ -123,6 +140,8 @@ struct Move {
         return !(*this == other);
     }
 
+    bool is_none() const { return from == SQ_NONE; }
+
     void print_move() const {
         if (type == PAWN) {
             std::cout << "Pawn move from " << square_to_string(from) << " to " << square_to_string(to) << "\n";
@@ -132,4 +151,6 @@ struct Move {
             std::cout << "Vertical wall at " << square_to_string(from) << "\n";
         }
     }
-};
\ No newline at end of file
+};
+
+constexpr Move MOVE_NONE{SQ_NONE, SQ_NONE, PAWN};